@@ -0,0 +1,217 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file accounting of the heap memory the modules allocate for their payload.
+ *
+ * Every module with payload allocations (packet pools, PES arenas, picture pools, ...) gets an account by its
+ * name, and its allocators report what they take from and give back to the heap. Per module the current
+ * bytes, the peak bytes, the amount of allocations and the allocation rate (bytes allocated in the last
+ * ALLOCATION_RATE_WINDOW simulated seconds) are kept. With "traceAllocations": true in the configuration, the values are traced as
+ * "<module>.allocatedBytes" ... like any other trace, and report() prints a summary at the end of the run.
+ *
+ * The pools hand out recycled memory without an allocation, so only heap growth is counted.
+ */
+
+#ifndef FRAMEWORK_ALLOCATIONTRACKER_H_
+#define FRAMEWORK_ALLOCATIONTRACKER_H_
+
+#include "systemc.h"
+#include "framework/Configuration.h"
+#include "framework/CsvTrace.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <stddef.h>
+
+#define MODULE_ID_STR "/digisoft/simulator/framework/AllocationTracker"
+#define ALLOCATION_RATE_WINDOW 1.0 /** seconds of simulated time the allocation rate is taken over */
+
+class AllocationTracker;
+
+/** @brief the allocations of one module */
+class AllocationAccount {
+public:
+    AllocationAccount(AllocationTracker& tracker, const std::string& name):
+        m_tracker(tracker),
+        m_name(name)
+    {
+    };
+
+    /** @brief bytes taken from the heap, nothing is counted for 0 bytes */
+    void allocate(size_t bytes);
+
+    /** @brief bytes given back to the heap */
+    void free(size_t bytes);
+
+    const std::string& name() const {
+        return m_name;
+    }
+
+    unsigned long bytes = 0;          /** held at the moment */
+    unsigned long peakBytes = 0;
+    unsigned long allocations = 0;
+    unsigned long allocatedBytes = 0; /** sum of all allocations */
+    double allocationRate = 0;        /** bytes allocated per simulated second, in the last window */
+
+private:
+    void slideWindow(double now);
+
+    AllocationTracker& m_tracker;
+    std::string m_name;
+    std::deque<std::pair<double, size_t> > m_window; /** time and size of the allocations in the window */
+    unsigned long m_windowBytes = 0;
+};
+
+class AllocationTracker {
+public:
+    static AllocationTracker& getInstance() {
+        static AllocationTracker instance;
+        return instance;
+    }
+
+    /** @brief the account of a module, created on the first call. Call it during elaboration, so it can be traced.
+     *
+     * @param name name of the module, all allocators of a module share its account
+     */
+    std::shared_ptr<AllocationAccount> account(const std::string& name) {
+        std::shared_ptr<AllocationAccount>& account = m_accounts[name];
+        if (!account) {
+            account = std::make_shared<AllocationAccount>(*this, name);
+            trace(*account);
+        }
+        return account;
+    }
+
+    /** @brief print current and peak bytes of every module, and of all together
+     */
+    void report() {
+        for (std::map<std::string, std::shared_ptr<AllocationAccount> >::iterator it = m_accounts.begin(); it != m_accounts.end(); ++it) {
+            AllocationAccount& account = *it->second;
+            std::string message;
+            message += account.name();
+            message += ": allocated bytes: ";
+            message += std::to_string(account.bytes);
+            message += " peak: ";
+            message += std::to_string(account.peakBytes);
+            message += " allocations: ";
+            message += std::to_string(account.allocations);
+            message += " total: ";
+            message += std::to_string(account.allocatedBytes);
+            message += " bytes per second: ";
+            message += std::to_string(account.allocationRate);
+            SC_REPORT_INFO(MODULE_ID_STR, message.c_str());
+        }
+        std::string message;
+        message += "all modules: allocated bytes: ";
+        message += std::to_string(this->bytes);
+        message += " peak: ";
+        message += std::to_string(this->peakBytes);
+        SC_REPORT_INFO(MODULE_ID_STR, message.c_str());
+    }
+
+    unsigned long bytes = 0;     /** all modules */
+    unsigned long peakBytes = 0; /** peak of the sum, not the sum of the peaks */
+
+private:
+    friend class AllocationAccount;
+
+    AllocationTracker() {};
+    AllocationTracker(AllocationTracker const&);
+    void operator=(AllocationTracker const&);
+
+    void trace(AllocationAccount& account) {
+        Configuration& config = Configuration::getInstance();
+        if (!config.HasMember("traceAllocations")) {
+            return;
+        }
+        if (!config["traceAllocations"].IsBool()) {
+            std::string message;
+            message += "Malformed configuration. \"traceAllocations\" is no Bool. Allocations will not been logged";
+            SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+            return;
+        }
+        if (!config["traceAllocations"].GetBool()) {
+            return;
+        }
+        if (!m_csvTrace) {
+            m_csvTrace = std::make_shared<CsvTrace>(config.dir());
+            m_csvTrace->delta_cycles(true);
+            m_csvTrace->trace(this->bytes, "allocations.allocatedBytes", "allocated bytes of all modules");
+        }
+        m_csvTrace->trace(account.bytes, std::string(account.name()).append(".allocatedBytes"), "allocated bytes");
+        m_csvTrace->trace(account.peakBytes, std::string(account.name()).append(".peakBytes"), "peak of allocated bytes");
+        m_csvTrace->trace(account.allocationRate, std::string(account.name()).append(".allocationRate"), "allocated bytes per second");
+    }
+
+    void changed(long bytes) {
+        this->bytes += bytes;
+        this->peakBytes = std::max(this->peakBytes, this->bytes);
+    }
+
+    std::map<std::string, std::shared_ptr<AllocationAccount> > m_accounts;
+    std::shared_ptr<CsvTrace> m_csvTrace;
+};
+
+inline void AllocationAccount::allocate(size_t bytes)
+{
+    if (bytes == 0) {
+        return;
+    }
+    this->bytes += bytes;
+    this->peakBytes = std::max(this->peakBytes, this->bytes);
+    this->allocations++;
+    this->allocatedBytes += bytes;
+
+    double now = sc_time_stamp().to_seconds();
+    m_window.push_back(std::make_pair(now, bytes));
+    m_windowBytes += bytes;
+    slideWindow(now);
+    m_tracker.changed(bytes);
+}
+
+inline void AllocationAccount::free(size_t bytes)
+{
+    if (bytes == 0) {
+        return;
+    }
+    this->bytes -= bytes;
+    slideWindow(sc_time_stamp().to_seconds());
+    m_tracker.changed(-(long)bytes);
+}
+
+/** @brief drop the allocations older than ALLOCATION_RATE_WINDOW, and take the rate over the rest
+ */
+inline void AllocationAccount::slideWindow(double now)
+{
+    while (!m_window.empty() && m_window.front().first <= now - ALLOCATION_RATE_WINDOW) {
+        m_windowBytes -= m_window.front().second;
+        m_window.pop_front();
+    }
+    this->allocationRate = m_windowBytes / ALLOCATION_RATE_WINDOW;
+}
+
+#undef MODULE_ID_STR
+#undef ALLOCATION_RATE_WINDOW
+#endif /* FRAMEWORK_ALLOCATIONTRACKER_H_ */
@@ -0,0 +1,70 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file time keeping of an input element, that runs ahead of the simulation time (temporal decoupling).
+ *
+ * The element writes its packets at its local time, and only synchronizes with the simulation time once per
+ * "quantum" (see main.cpp). Without a quantum every advance() is a wait().
+ */
+
+#ifndef FRAMEWORK_DECOUPLEDWRITER_H_
+#define FRAMEWORK_DECOUPLEDWRITER_H_
+
+#include "systemc.h"
+#include "tlm_utils/tlm_quantumkeeper.h"
+
+class DecoupledWriter {
+public:
+    /** @brief hand a packet to the buffer behind out, at the local time of the element.
+     *
+     * @param out port to a buffer, with a write(packet, delay) for writers ahead of the simulation time
+     * @param packet the packet
+     */
+    template<class Out>
+    void write(Out& out, uint8_t* packet) {
+        sc_time delay = m_quantumKeeper.get_local_time();
+        out->write(packet, delay);
+        m_quantumKeeper.set(delay);
+    }
+
+    /** @brief let time pass. Only the local time is increased, and the simulation time is synchronized once
+     * per quantum.
+     */
+    void advance(double seconds) {
+        m_quantumKeeper.inc(sc_time(seconds, SC_SEC));
+        if (m_quantumKeeper.need_sync()) {
+            m_quantumKeeper.sync();
+        }
+    }
+
+    /** @brief simulation time plus the local time of the element
+     */
+    sc_time currentTime() const {
+        return m_quantumKeeper.get_current_time();
+    }
+
+private:
+    tlm_utils::tlm_quantumkeeper m_quantumKeeper;
+};
+
+#endif /* FRAMEWORK_DECOUPLEDWRITER_H_ */
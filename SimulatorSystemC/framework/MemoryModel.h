@@ -0,0 +1,160 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file model of the RAM the simulated set top box needs for its buffers.
+ *
+ * Every buffer gets a region by its name, and sets the bytes it occupies whenever its fill changes. The
+ * buffers count their fill in different units (elements, pictures, bytes), the region always is in bytes,
+ * e.g. a picture buffer counts width * height * bytes per pixel per picture. The sum of all regions is the
+ * RAM the modeled box needs at that time, its peak is what the hardware has to provide.
+ *
+ * With "traceMemoryModel": true in the configuration, every region is traced as "<buffer>.modeledBytes",
+ * and the sum as "memoryModel.bytes" and "memoryModel.peakBytes". report() prints the peaks at the end of
+ * the run.
+ */
+
+#ifndef FRAMEWORK_MEMORYMODEL_H_
+#define FRAMEWORK_MEMORYMODEL_H_
+
+#include "systemc.h"
+#include "framework/Configuration.h"
+#include "framework/CsvTrace.h"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+
+#define MODULE_ID_STR "/digisoft/simulator/framework/MemoryModel"
+
+class MemoryModel;
+
+/** @brief the modeled RAM of one buffer */
+class MemoryRegion {
+public:
+    MemoryRegion(MemoryModel& model, const std::string& name):
+        m_model(model),
+        m_name(name)
+    {
+    };
+
+    /** @brief the buffer occupies bytes now */
+    void set(unsigned long bytes);
+
+    const std::string& name() const {
+        return m_name;
+    }
+
+    unsigned long bytes = 0;
+    unsigned long peakBytes = 0;
+
+private:
+    MemoryModel& m_model;
+    std::string m_name;
+};
+
+class MemoryModel {
+public:
+    static MemoryModel& getInstance() {
+        static MemoryModel instance;
+        return instance;
+    }
+
+    /** @brief the region of a buffer, created on the first call. Call it during elaboration, so it can be traced.
+     */
+    std::shared_ptr<MemoryRegion> region(const std::string& name) {
+        std::shared_ptr<MemoryRegion>& region = m_regions[name];
+        if (!region) {
+            region = std::make_shared<MemoryRegion>(*this, name);
+            trace(*region);
+        }
+        return region;
+    }
+
+    /** @brief print the peak of every region, and the peak of the sum
+     */
+    void report() {
+        for (std::map<std::string, std::shared_ptr<MemoryRegion> >::iterator it = m_regions.begin(); it != m_regions.end(); ++it) {
+            std::string message;
+            message += it->second->name();
+            message += ": modeled peak bytes: ";
+            message += std::to_string(it->second->peakBytes);
+            SC_REPORT_INFO(MODULE_ID_STR, message.c_str());
+        }
+        std::string message;
+        message += "modeled RAM of all buffers: peak bytes: ";
+        message += std::to_string(this->peakBytes);
+        SC_REPORT_INFO(MODULE_ID_STR, message.c_str());
+    }
+
+    unsigned long bytes = 0;     /** all regions */
+    unsigned long peakBytes = 0; /** peak of the sum, not the sum of the peaks */
+
+private:
+    friend class MemoryRegion;
+
+    MemoryModel() {};
+    MemoryModel(MemoryModel const&);
+    void operator=(MemoryModel const&);
+
+    void trace(MemoryRegion& region) {
+        Configuration& config = Configuration::getInstance();
+        if (!config.HasMember("traceMemoryModel")) {
+            return;
+        }
+        if (!config["traceMemoryModel"].IsBool()) {
+            std::string message;
+            message += "Malformed configuration. \"traceMemoryModel\" is no Bool. The memory model will not been logged";
+            SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+            return;
+        }
+        if (!config["traceMemoryModel"].GetBool()) {
+            return;
+        }
+        if (!m_csvTrace) {
+            m_csvTrace = std::make_shared<CsvTrace>(config.dir());
+            m_csvTrace->delta_cycles(true);
+            m_csvTrace->trace(this->bytes, "memoryModel.bytes", "modeled RAM of all buffers in Bytes");
+            m_csvTrace->trace(this->peakBytes, "memoryModel.peakBytes", "peak of the modeled RAM in Bytes");
+        }
+        m_csvTrace->trace(region.bytes, std::string(region.name()).append(".modeledBytes"), "modeled RAM in Bytes");
+    }
+
+    void changed(unsigned long before, unsigned long after) {
+        this->bytes = this->bytes - before + after;
+        this->peakBytes = std::max(this->peakBytes, this->bytes);
+    }
+
+    std::map<std::string, std::shared_ptr<MemoryRegion> > m_regions;
+    std::shared_ptr<CsvTrace> m_csvTrace;
+};
+
+inline void MemoryRegion::set(unsigned long bytes)
+{
+    unsigned long before = this->bytes;
+    this->bytes = bytes;
+    this->peakBytes = std::max(this->peakBytes, bytes);
+    m_model.changed(before, bytes);
+}
+
+#undef MODULE_ID_STR
+#endif /* FRAMEWORK_MEMORYMODEL_H_ */
@@ -0,0 +1,107 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file bounded lock free ring buffer for one producer and one consumer thread.
+ */
+
+#ifndef FRAMEWORK_SPSCRING_H_
+#define FRAMEWORK_SPSCRING_H_
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+
+/** @brief lock free single producer single consumer ring.
+ *
+ * The slots are allocated once. The producer fills the slot it gets from @producerSlot() in place and
+ * hands it over with @publish(), the consumer reads the slot from @consumerSlot() in place and gives it
+ * back with @consume(). So there is no copy of the elements and no allocation after construction.
+ */
+template<class T>
+class SpscRing {
+public:
+    /** @param capacity amount of slots, is rounded up to a power of two.
+     */
+    explicit SpscRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    size_t capacity() const {
+        return m_slots.size();
+    }
+
+    /** @brief producer side: get the next free slot
+     *
+     * @return the slot, or NULL if the ring is full
+     */
+    T* producerSlot() {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == m_slots.size()) {
+            return NULL;
+        }
+        return &m_slots[head & m_mask];
+    }
+
+    /** @brief producer side: make the slot from @producerSlot() visible to the consumer
+     */
+    void publish() {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** @brief consumer side: get the oldest published slot
+     *
+     * @return the slot, or NULL if the ring is empty
+     */
+    T* consumerSlot() {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return NULL;
+        }
+        return &m_slots[tail & m_mask];
+    }
+
+    /** @brief consumer side: give the slot from @consumerSlot() back to the producer
+     */
+    void consume() {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    SpscRing(const SpscRing&);             // disable copy
+    SpscRing& operator= (const SpscRing&); // disable =
+
+    std::vector<T> m_slots;
+    size_t m_mask;
+
+    // head and tail are written by different threads, keep them on different cache lines
+    std::atomic<size_t> m_head{0};
+    char m_padding[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_tail{0};
+};
+
+#endif /* FRAMEWORK_SPSCRING_H_ */
@@ -26,9 +26,13 @@
  */
 #include <framework/MainModel.h>
 #include "systemc.h"
+#include "tlm_utils/tlm_quantumkeeper.h"
 #include "time.h"
 #include "framework/Configuration.h"
 #include "framework/CsvTrace.h"
+#include "framework/AllocationTracker.h"
+#include "framework/MemoryModel.h"
+#include <modules/elements/buffers/SharedMemoryPool.h>
 #include <string>
 
 /**
@@ -58,6 +62,19 @@ int sc_main (int argc, char* argv[])
         exit(-1);
     }
 
+    /*
+     * optional quantum (in seconds) for temporal decoupling. The input modules run ahead of the simulation
+     * time and only synchronize once per quantum, see DecoupledWriter.h. 0 (default) synchronizes every packet.
+     */
+    if (config.HasMember("quantum")) {
+        if (!config["quantum"].IsNumber() || config["quantum"].GetDouble() < 0) {
+            std::string message;
+            message += "\"quantum:\" is no positive Number.";
+            SC_REPORT_FATAL("/digisoft/simulator/main", message.c_str());
+        }
+        tlm_utils::tlm_quantumkeeper::set_global_quantum(sc_time(config["quantum"].GetDouble(), SC_SEC));
+    }
+
     const std::shared_ptr<sc_module> mainModel = MainModel::getMainModel();
 
     if (!config.HasMember("runTime") || !config["runTime"].IsInt()) {
@@ -78,5 +95,8 @@ int sc_main (int argc, char* argv[])
     message += " simulated Time: ";
     message += std::to_string(sc_time_stamp().to_seconds());
     SC_REPORT_INFO("/digisoft/simulator/main", message.c_str());
+    AllocationTracker::getInstance().report();
+    MemoryModel::getInstance().report();
+    SharedMemoryPool::reportAll();
     return 0;
 }
@@ -35,6 +35,7 @@
 #include "rapidjson/document.h"
 #include "framework/CsvTrace.h"
 #include <string>
+#include <memory>
 
 #define MODULE_ID_STR "/digisoft/simulator/modules/elements/OutPut"
 
@@ -43,7 +44,7 @@ SC_MODULE(OutPut)
 {
 public:
     sc_out<bool> frameRequest;
-    sc_in<uint8_t*> frameIn;
+    sc_in<std::shared_ptr<uint8_t> > frameIn;
 
     bool displayFrame = false;
     double frameTimeOut = 0;
@@ -103,7 +104,7 @@ public:
      */
     void process()
     {
-        uint8_t* frame = NULL;
+        std::shared_ptr<uint8_t> frame;
         while(true)
         {
             frameRequest.write(true);
@@ -127,7 +128,8 @@ public:
                     m_firstFrameShowed = true;
                 }
                 displayFrame = true;
-                delete[] frame;
+                // the frame is shared with the picture buffer, it is freed with its last reference
+                frame.reset();
             }
             frameRequest.write(false);
 
@@ -23,16 +23,29 @@
  *
  * this element takes a multicast and an aux file, used by multicat. It uses the same way like multicat of
  * determining at witch time a package shlud be send.
+ *
+ * The TS file is read with the "inputMode" known from the TunerDVB ("stream", "mmap" or "readAhead"). The aux file is
+ * always mapped, and its timestamps are decoded in blocks.
+ *
+ * With "startTime" (seconds since the first PCR, on "pcrPid" or the first pid carrying a PCR) reading starts at
+ * the last random access point, at least "preRoll" seconds before. See TsStartTime.h.
  */
 
 #ifndef READMULTICAST_H_
 #define READMULTICAST_H_
 
 #include <modules/elements/buffers/BufferFill.h>
+#include <modules/elements/input/TsInputFactory.h>
+#include <modules/elements/input/TsSync.h>
+#include <modules/elements/input/TsPacketFormat.h>
+#include <modules/elements/input/MulticatAux.h>
+#include <modules/elements/input/TsStartTime.h>
 #include "systemc.h"
+#include "framework/DecoupledWriter.h"
 #include "framework/Configuration.h"
 #include "rapidjson/document.h"
 #include "framework/CsvTrace.h"
+#include "framework/AllocationTracker.h"
 #include "mpeg/ts.h"
 #include <string>
 #include <fstream>
@@ -46,9 +59,20 @@ public:
     sc_port<BufferFillOutIf> out;
     std::string filename;
     std::string filenameAux;
+    std::string inputMode = "stream";
+    TsPacketFormat packetFormat = TS_PACKET_FORMAT_TS;
+    int syncLock = TS_SYNC_LOCK_COUNT;
+    unsigned long skippedBytes = 0;
+    int burstSize = 0;
+    int pcrPid = -1;
+    TsStartTime start;
+    uint64_t startOffset = 0;
 
 private:
     std::shared_ptr<CsvTrace> m_csvTrace;
+    std::shared_ptr<TsInput> m_input;
+    DecoupledWriter m_writer;
+    MulticatAux m_aux;
 public:
     void loadConfig() {
         Configuration& config = Configuration::getInstance();
@@ -83,6 +107,61 @@ public:
 
         this->filenameAux = s["filenameAux"].GetString();
 
+        if (s.HasMember("packetFormat")) {
+            if (!s["packetFormat"].IsString() || !tsPacketFormatFromString(s["packetFormat"].GetString(), this->packetFormat)) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"packetFormat\" is no String or unknown";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+        }
+
+        if (s.HasMember("inputMode")) {
+            if (!s["inputMode"].IsString()) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"inputMode\" is no String";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->inputMode = s["inputMode"].GetString();
+        }
+
+        m_input = createTsInput(this->inputMode);
+        if (!m_input) {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += this->name();
+            message += "\". unknown \"inputMode\": ";
+            message += this->inputMode;
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        if (s.HasMember("syncLock")) {
+            if (!s["syncLock"].IsInt() || s["syncLock"].GetInt() < 1) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"syncLock\" is no Int greater than 0";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->syncLock = s["syncLock"].GetInt();
+        }
+
+        if (s.HasMember("pcrPid")) {
+            if (!s["pcrPid"].IsInt()) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"pcrPid\" is no Int";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->pcrPid = s["pcrPid"].GetInt();
+        }
+
+        this->start.loadConfig(s, this->name(), MODULE_ID_STR);
+
         if (!s.HasMember("trace") || !s["trace"].IsBool()) {
             std::string message;
             message += "Malformed configuration of \"";
@@ -93,33 +172,95 @@ public:
             if (s["trace"].GetBool()) {
                 m_csvTrace = std::make_shared<CsvTrace>(config.dir());
                 m_csvTrace->delta_cycles(true);
-                /*nothing to Trace
-                 * use
-                 * m_csvTrace->trace(variable,file ending,ylable)
-                 * to trace a property
-                 * */
+                m_csvTrace->trace(this->skippedBytes, std::string(this->name()).append(".skippedBytes"), "bytes skipped to find the sync byte");
+                m_csvTrace->trace(this->burstSize, std::string(this->name()).append(".burstSize"), "packets sent at the same time");
             }
         }
     }
 
+    /** @brief open the given input, and report if it didn't work
+     */
+    bool openInput(TsInput& input, const std::string& filename, uint64_t offset) {
+        if (!input.open(filename, offset)) {
+            std::string message;
+            message += "could not open \"";
+            message += filename;
+            message += "\" for: \"";
+            message += this->name();
+            message += "\".";
+            SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    /** @brief tell the demux the layout of the packets, before it starts reading.
+     */
+    void start_of_simulation() {
+        out->setPacketFormat(this->packetFormat);
+    }
+
     void read() {
-        int search = 0;
-        char* tsPacket;
-        char pAux[8];
-        ifstream file;
-        ifstream fileAux;
-        uint64_t auxStc;
-        double timeToSleep;
-        file.open(this->filename, ifstream::in | ifstream::binary );
-        fileAux.open(this->filenameAux, ifstream::in | ifstream::binary );
+        this->startOffset = this->start.findOffset(this->filename, this->packetFormat, this->pcrPid, this->syncLock,
+                                                   this->name(), MODULE_ID_STR);
 
+        if (!openInput(*m_input, this->filename, this->startOffset)) {
+            return;
+        }
+        if (!m_aux.open(this->filenameAux)) {
+            std::string message;
+            message += "could not open \"";
+            message += this->filenameAux;
+            message += "\" for: \"";
+            message += this->name();
+            message += "\".";
+            SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+            return;
+        }
+        out->setPacketOwner(m_input.get());
+
+        switch (this->packetFormat) {
+            case TS_PACKET_FORMAT_M2TS:
+                readPackets<TsFormatM2ts>();
+                break;
+            case TS_PACKET_FORMAT_TS204:
+                readPackets<TsFormatTs204>();
+                break;
+            default:
+                readPackets<TsFormatTs>();
+        }
+    }
+
+    /** @brief the read loop, for one packet format.
+     *
+     * @tparam Format TsPacketLayout of the file
+     */
+    template<class Format>
+    void readPackets() {
+        uint8_t* tsPacket;
+        const uint8_t* data;
+        uint64_t auxStc;
+        uint64_t nextAuxStc;
+        size_t packet = this->startOffset / Format::packetSize; // multicat writes one timestamp per packet
+        int burstCount = 0;
 
         while (true) {
-            tsPacket = new char[188];
-            file.read(tsPacket, 188);
-            fileAux.read(pAux,8);
+            if (m_input->peek(data, Format::packetSize) == Format::packetSize && !ts_validate(data + Format::headerOffset))
+            {
+                SC_REPORT_WARNING(MODULE_ID_STR,"invalid tsPacket, trying to find sync byte");
+                size_t search = tsResync(*m_input, Format::packetSize, this->syncLock, Format::headerOffset);
+                this->skippedBytes += search;
 
-            if (!file) {
+                std::string message;
+                message += "sync byte found ";
+                message += std::to_string(search);
+                message += " bytes Later.";
+                SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+            }
+
+            tsPacket = m_input->take(Format::packetSize);
+
+            if (!tsPacket) {
                 std::string message;
                 message += "file Error (Maybe end of file reached) for: \"";
                 message += this->name();
@@ -128,62 +269,40 @@ public:
                 break;
             }
 
-            if (!fileAux) {
+            if (!m_aux.get(packet, auxStc)) {
                 std::string message;
                 message += "fileAux Error (Maybe end of file reached) for: \"";
                 message += this->name();
                 message += "\".";
                 SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+                m_input->release(tsPacket);
                 break;
             }
+            packet++;
 
-            /*
-             * compare to mulitcat util.h FromSTC()
-             */
-            auxStc = ((uint64_t)pAux[0] << 56)
-                 | ((uint64_t)pAux[1] << 48)
-                 | ((uint64_t)pAux[2] << 40)
-                 | ((uint64_t)pAux[3] << 32)
-                 | ((uint64_t)pAux[4] << 24)
-                 | ((uint64_t)pAux[5] << 16)
-                 | ((uint64_t)pAux[6] << 8)
-                 | ((uint64_t)pAux[7] << 0);
-            timeToSleep = auxStc/27e6;
-
-            while (!ts_validate((uint8_t*)tsPacket))
-            {
-                if (search == 0)
-                {
-                    SC_REPORT_WARNING(MODULE_ID_STR,"invalid tsPacket, trying to find sync byte");
-                }
-                file.seekg(-187,ios_base::cur);
-                file.read(tsPacket, 188);
-                search ++;
-            }
-            if (search != 0)
-            {
-                std::string message;
-                message += "sync byte found ";
-                message += std::to_string(search);
-                message += " bytes Later.";
-                SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
-                search = 0;
-            }
+            m_writer.write(out, tsPacket);
+            burstCount++;
 
-            out->write((uint8_t*)tsPacket);
             /*
              * multicat sleeps before sending. We sleep after. So we don't have to care about the first package (witch has no delay).
              * We could do this, because reading from file, dons't matter in the simulation time, while multicat has to care about the reading
              * time.
+             * multicat gives all packets of one UDP datagram the same timestamp. These packets are sent as one burst, with one wait
+             * till the timestamp of the next packet.
              */
-            wait(timeToSleep,SC_SEC);
+            if (m_aux.get(packet, nextAuxStc) && nextAuxStc != auxStc) {
+                this->burstSize = burstCount;
+                burstCount = 0;
+                if (nextAuxStc > auxStc) {
+                    m_writer.advance((nextAuxStc - auxStc) / 27e6);
+                }
+            }
         }
-
-        file.close();
     }
 
     SC_CTOR(ReadMulticast) {
         this->loadConfig();
+        m_input->setAccount(AllocationTracker::getInstance().account(this->name()));
         SC_THREAD(read);
     }
 };
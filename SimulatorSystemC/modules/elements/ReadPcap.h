@@ -0,0 +1,188 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * this element replays a pcap or pcapng capture of a UDP multicast (plain TS or RTP). The TS packets are
+ * handed to the buffer without copying, as views into the mapped capture. All packets of one datagram are
+ * sent at once, and the time till the next datagram is taken from the capture timestamps.
+ *
+ * With "udpPort" only the datagrams sent to this port are used, otherwise all datagrams carrying TS.
+ */
+
+#ifndef READPCAP_H_
+#define READPCAP_H_
+
+#include <modules/elements/buffers/BufferFill.h>
+#include <modules/elements/input/PcapFile.h>
+#include <modules/elements/input/UdpTsPayload.h>
+#include "systemc.h"
+#include "framework/DecoupledWriter.h"
+#include "framework/Configuration.h"
+#include "rapidjson/document.h"
+#include "framework/CsvTrace.h"
+#include "mpeg/ts.h"
+#include <string>
+#include <memory>
+
+#define MODULE_ID_STR "/digisoft/simulator/modules/elements/ReadPcap"
+
+SC_MODULE(ReadPcap)
+{
+public:
+    sc_port<BufferFillOutIf> out;
+    std::string filename;
+    int udpPort = -1;
+    unsigned long skippedDatagrams = 0;
+    int burstSize = 0;
+
+private:
+    std::shared_ptr<CsvTrace> m_csvTrace;
+    DecoupledWriter m_writer;
+    PcapFile m_pcap;
+public:
+    void loadConfig() {
+        Configuration& config = Configuration::getInstance();
+
+        if (!config.HasMember(this->name())) {
+            std::string message;
+            message += "No Configuration found for: \"";
+            message += this->name();
+            message += "\"";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        rapidjson::Value& s = config[this->name()];
+
+        if (!s.HasMember("filename") || !s["filename"].IsString()) {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += this->name();
+            message += "\". \"filename\" is missing or no String";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        this->filename = s["filename"].GetString();
+
+        if (s.HasMember("udpPort")) {
+            if (!s["udpPort"].IsInt() || s["udpPort"].GetInt() < 0 || s["udpPort"].GetInt() > 0xffff) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"udpPort\" is no valid port";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->udpPort = s["udpPort"].GetInt();
+        }
+
+        if (!s.HasMember("trace") || !s["trace"].IsBool()) {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"trace\" is missing or no Bool. This Module will not been logged";
+            SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+        } else {
+            if (s["trace"].GetBool()) {
+                m_csvTrace = std::make_shared<CsvTrace>(config.dir());
+                m_csvTrace->delta_cycles(true);
+                m_csvTrace->trace(this->skippedDatagrams, std::string(this->name()).append(".skippedDatagrams"), "datagrams without TS packets");
+                m_csvTrace->trace(this->burstSize, std::string(this->name()).append(".burstSize"), "packets sent at the same time");
+            }
+        }
+    }
+
+    /** @brief get the next datagram carrying TS packets.
+     *
+     * @return false at the end of the capture
+     */
+    bool nextDatagram(PcapDatagram& datagram, const uint8_t*& ts, size_t& count) {
+        while (m_pcap.next(datagram)) {
+            if (this->udpPort >= 0 && datagram.destinationPort != this->udpPort) {
+                continue;
+            }
+            if (udpTsPayload(datagram.payload, datagram.size, ts, count)) {
+                return true;
+            }
+            this->skippedDatagrams++;
+        }
+        return false;
+    }
+
+    void read() {
+        PcapDatagram datagram;
+        PcapDatagram following;
+        const uint8_t* ts;
+        const uint8_t* nextTs;
+        size_t count;
+        size_t nextCount;
+
+        if (!m_pcap.open(this->filename)) {
+            std::string message;
+            message += "could not open \"";
+            message += this->filename;
+            message += "\" as pcap or pcapng for: \"";
+            message += this->name();
+            message += "\".";
+            SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+            return;
+        }
+        out->setPacketOwner(&m_pcap);
+
+        if (!this->nextDatagram(datagram, ts, count)) {
+            SC_REPORT_WARNING(MODULE_ID_STR, "no TS packets found in the capture");
+            return;
+        }
+        uint64_t latest = datagram.time; // largest capture time so far
+
+        while (true) {
+            // the packets are views into the mapping. It is copy on write, so a writing reader can't harm the file.
+            for (size_t i = 0; i < count; i++) {
+                m_writer.write(out, const_cast<uint8_t*>(ts + i * TS_SIZE));
+            }
+            this->burstSize = count;
+
+            if (!this->nextDatagram(following, nextTs, nextCount)) {
+                std::string message;
+                message += "end of capture reached for: \"";
+                message += this->name();
+                message += "\".";
+                SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+                break;
+            }
+
+            // captures are not always ordered by time. A datagram from before the latest one is sent at once, and
+            // the time goes on only from the latest capture time on, so no interval is counted twice.
+            if (following.time > latest) {
+                m_writer.advance((following.time - latest) / 1e9);
+                latest = following.time;
+            }
+            ts = nextTs;
+            count = nextCount;
+        }
+    }
+
+    SC_CTOR(ReadPcap) {
+        this->loadConfig();
+        SC_THREAD(read);
+    }
+};
+#undef MODULE_ID_STR
+#endif //READPCAP_H_
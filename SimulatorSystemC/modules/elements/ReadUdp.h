@@ -0,0 +1,246 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * this element receives a live TS over UDP (plain or RTP), e.g. from a headend or a local sender. The
+ * datagrams are received in a host thread, many with one system call (see UdpReceiver.h).
+ *
+ * The simulation is locked to the wall clock: a packet is sent at the simulation time that passed in
+ * reality since the start, when it was received. While nothing is received, the simulation follows the
+ * wall clock as well, so the buffers behind drain like they would in a real receiver. Only if the model
+ * runs faster than real time, the simulator waits for the next datagram or for the wall clock.
+ */
+
+#ifndef READUDP_H_
+#define READUDP_H_
+
+#include <modules/elements/buffers/BufferFill.h>
+#include <modules/elements/buffers/PacketPool.h>
+#include <modules/elements/input/UdpReceiver.h>
+#include <modules/elements/input/UdpTsPayload.h>
+#include "systemc.h"
+#include "framework/DecoupledWriter.h"
+#include "framework/Configuration.h"
+#include "rapidjson/document.h"
+#include "framework/CsvTrace.h"
+#include "framework/AllocationTracker.h"
+#include "mpeg/ts.h"
+#include <cstring>
+#include <string>
+#include <memory>
+
+#define MODULE_ID_STR "/digisoft/simulator/modules/elements/ReadUdp"
+#define READ_UDP_AHEAD_NS 1000000 /** the simulation runs this far ahead of the wall clock, while nothing is received */
+
+SC_MODULE(ReadUdp)
+{
+public:
+    sc_port<BufferFillOutIf> out;
+    std::string address;
+    int port;
+    std::string interface;
+    int batch = 64;
+    int receiveBuffer = 0;
+    unsigned long skippedDatagrams = 0;
+    unsigned long droppedDatagrams = 0;
+
+private:
+    std::shared_ptr<CsvTrace> m_csvTrace;
+    DecoupledWriter m_writer;
+    UdpReceiver m_receiver;
+    PacketPool m_packets;
+    uint64_t m_wallStart = 0;
+    sc_time m_simStart;
+public:
+    void loadConfig() {
+        Configuration& config = Configuration::getInstance();
+
+        if (!config.HasMember(this->name())) {
+            std::string message;
+            message += "No Configuration found for: \"";
+            message += this->name();
+            message += "\"";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        rapidjson::Value& s = config[this->name()];
+
+        if (!s.HasMember("address") || !s["address"].IsString()) {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += this->name();
+            message += "\". \"address\" is missing or no String";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        this->address = s["address"].GetString();
+
+        if (!s.HasMember("port") || !s["port"].IsInt() || s["port"].GetInt() < 0 || s["port"].GetInt() > 0xffff) {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += this->name();
+            message += "\". \"port\" is missing or no valid port";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        this->port = s["port"].GetInt();
+
+        if (s.HasMember("interface")) {
+            if (!s["interface"].IsString()) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"interface\" is no String";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->interface = s["interface"].GetString();
+        }
+
+        if (s.HasMember("batch")) {
+            if (!s["batch"].IsInt() || s["batch"].GetInt() < 1) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"batch\" is no Int greater than 0";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->batch = s["batch"].GetInt();
+        }
+
+        if (s.HasMember("receiveBuffer")) {
+            if (!s["receiveBuffer"].IsInt() || s["receiveBuffer"].GetInt() < 0) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"receiveBuffer\" is no positive Int";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->receiveBuffer = s["receiveBuffer"].GetInt();
+        }
+
+        if (!s.HasMember("trace") || !s["trace"].IsBool()) {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"trace\" is missing or no Bool. This Module will not been logged";
+            SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+        } else {
+            if (s["trace"].GetBool()) {
+                m_csvTrace = std::make_shared<CsvTrace>(config.dir());
+                m_csvTrace->delta_cycles(true);
+                m_csvTrace->trace(this->skippedDatagrams, std::string(this->name()).append(".skippedDatagrams"), "datagrams without TS packets");
+                m_csvTrace->trace(this->droppedDatagrams, std::string(this->name()).append(".droppedDatagrams"), "datagrams dropped, simulation too slow");
+            }
+        }
+    }
+
+    /** @brief let the simulation time catch up with the wall clock.
+     *
+     * If the simulation is behind (the model is slower than real time), nothing is done.
+     *
+     * @param wallTime wall clock in nanoseconds
+     */
+    void followWallClock(uint64_t wallTime) {
+        if (wallTime <= m_wallStart) {
+            return;
+        }
+        double passed = (wallTime - m_wallStart) / 1e9;
+        double simulated = (m_writer.currentTime() - m_simStart).to_seconds();
+        if (passed > simulated) {
+            m_writer.advance(passed - simulated);
+        }
+    }
+
+    void read() {
+        if (!m_receiver.open(this->address, this->port, this->interface, this->batch, this->receiveBuffer)) {
+            std::string message;
+            message += "could not receive on \"";
+            message += this->address;
+            message += ":";
+            message += std::to_string(this->port);
+            message += "\" for: \"";
+            message += this->name();
+            message += "\".";
+            SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+            return;
+        }
+        // the packets are copied out of the receive batches into the pool
+        out->setPacketOwner(&m_packets);
+
+        std::string message;
+        message += "receiving on \"";
+        message += this->address;
+        message += ":";
+        message += std::to_string(this->port);
+        message += "\" for: \"";
+        message += this->name();
+        message += "\".";
+        SC_REPORT_INFO(MODULE_ID_STR, message.c_str());
+
+        m_wallStart = UdpReceiver::now();
+        m_simStart = sc_time_stamp();
+
+        while (true) {
+            UdpBatch* batch = m_receiver.batch();
+
+            if (batch == NULL) {
+                this->droppedDatagrams = m_receiver.dropped();
+                // let the rest of the model run till a bit after the wall clock
+                followWallClock(UdpReceiver::now() + READ_UDP_AHEAD_NS);
+                uint64_t simulated = m_wallStart + (uint64_t)((m_writer.currentTime() - m_simStart).to_seconds() * 1e9);
+                uint64_t now = UdpReceiver::now();
+                if (simulated > now) {
+                    // the model is faster than real time
+                    m_receiver.waitForBatch(simulated - now);
+                }
+                continue;
+            }
+
+            for (size_t i = 0; i < batch->count; i++) {
+                const uint8_t* ts;
+                size_t count;
+
+                if (!udpTsPayload(batch->datagram(i), batch->sizes[i], ts, count)) {
+                    this->skippedDatagrams++;
+                    continue;
+                }
+
+                followWallClock(batch->times[i]);
+                for (size_t j = 0; j < count; j++) {
+                    uint8_t* tsPacket = m_packets.get();
+                    memcpy(tsPacket, ts + j * TS_SIZE, TS_SIZE);
+                    m_writer.write(out, tsPacket);
+                }
+            }
+            m_receiver.consume();
+        }
+    }
+
+    SC_CTOR(ReadUdp) {
+        this->loadConfig();
+        m_packets.setAccount(AllocationTracker::getInstance().account(this->name()));
+        SC_THREAD(read);
+    }
+};
+#undef MODULE_ID_STR
+#undef READ_UDP_AHEAD_NS
+#endif //READUDP_H_
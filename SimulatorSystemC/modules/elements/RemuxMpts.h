@@ -0,0 +1,198 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file RemuxMpts.h
+ *
+ * this element remuxes several single program transport stream files ("filenames") into one multi program
+ * transport stream, in memory and without an intermediate file (see TsRemuxer.h for the pid mapping).
+ * The packets are sent at the arrival times given by the PCRs of their files, so the bit rate of the
+ * multiplex is the sum of the sources. The output is always 188 byte TS, whatever "packetFormat" the files have.
+ *
+ * The demux selects one program with the remapped pids, e.g. the first stream of the second file is 0x111.
+ */
+
+#ifndef REMUXMPTS_H_
+#define REMUXMPTS_H_
+
+#include <modules/elements/buffers/BufferFill.h>
+#include <modules/elements/buffers/PacketPool.h>
+#include <modules/elements/input/TsPacketFormat.h>
+#include <modules/elements/input/TsRemuxer.h>
+#include <modules/elements/input/TsSync.h>
+#include "systemc.h"
+#include "framework/DecoupledWriter.h"
+#include "framework/Configuration.h"
+#include "rapidjson/document.h"
+#include "framework/CsvTrace.h"
+#include "framework/AllocationTracker.h"
+#include "mpeg/ts.h"
+#include <string>
+#include <vector>
+#include <memory>
+
+#define MODULE_ID_STR "/digisoft/simulator/modules/elements/RemuxMpts"
+
+SC_MODULE(RemuxMpts)
+{
+public:
+    sc_port<BufferFillOutIf> out;
+
+private:
+    std::shared_ptr<CsvTrace> m_csvTrace;
+    DecoupledWriter m_writer;
+    std::vector<std::string> filenames;
+    TsPacketFormat packetFormat = TS_PACKET_FORMAT_TS;
+    int syncLock = TS_SYNC_LOCK_COUNT;
+    double psiInterval = 0.1;
+    TsRemuxer m_remuxer;
+    PacketPool m_packets;
+    int activeSources = 0;
+
+public:
+    void loadConfig() {
+        Configuration& config = Configuration::getInstance();
+
+        if (!config.HasMember(this->name())) {
+            std::string message;
+            message += "No Configuration found for: \"";
+            message += this->name();
+            message += "\"";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        rapidjson::Value& s = config[this->name()];
+
+        if (!s.HasMember("filenames") || !s["filenames"].IsArray() || s["filenames"].Empty()) {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += this->name();
+            message += "\". \"filenames\" is missing or no Array of Strings";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        for (rapidjson::SizeType i = 0; i < s["filenames"].Size(); i++) {
+            if (!s["filenames"][i].IsString()) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"filenames\" is missing or no Array of Strings";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->filenames.push_back(s["filenames"][i].GetString());
+        }
+
+        if (s.HasMember("packetFormat")) {
+            if (!s["packetFormat"].IsString() || !tsPacketFormatFromString(s["packetFormat"].GetString(), this->packetFormat)) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"packetFormat\" is no String or unknown";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+        }
+
+        if (s.HasMember("syncLock")) {
+            if (!s["syncLock"].IsInt() || s["syncLock"].GetInt() < 1) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"syncLock\" is no Int greater than 0";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->syncLock = s["syncLock"].GetInt();
+        }
+
+        if (s.HasMember("psiInterval")) {
+            if (!s["psiInterval"].IsNumber() || s["psiInterval"].GetDouble() <= 0) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"psiInterval\" is no positive Number";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->psiInterval = s["psiInterval"].GetDouble();
+        }
+
+        if (!s.HasMember("trace") || !s["trace"].IsBool()) {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"trace\" is missing or no Bool. This Module will not been logged";
+            SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+        } else {
+            if (s["trace"].GetBool()) {
+                m_csvTrace = std::make_shared<CsvTrace>(config.dir());
+                m_csvTrace->delta_cycles(true);
+                m_csvTrace->trace(this->activeSources, std::string(this->name()).append(".activeSources"), "files not at their end");
+            }
+        }
+    }
+
+    void remux() {
+        m_remuxer.setPsiInterval(this->psiInterval);
+        for (size_t i = 0; i < this->filenames.size(); i++) {
+            std::string error;
+            if (!m_remuxer.addSource(this->filenames[i], tsPacketFormatSize(this->packetFormat),
+                                     tsPacketFormatHeaderOffset(this->packetFormat), this->syncLock, error)) {
+                std::string message;
+                message += "could not use \"";
+                message += this->filenames[i];
+                message += "\" for: \"";
+                message += this->name();
+                message += "\": ";
+                message += error;
+                SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+            }
+        }
+        out->setPacketOwner(&m_packets);
+
+        double now = 0;
+        double time;
+        uint8_t* tsPacket = m_packets.get();
+        while (m_remuxer.next(tsPacket, time)) {
+            if (time > now) {
+                m_writer.advance(time - now);
+                now = time;
+            }
+            this->activeSources = m_remuxer.activeSources();
+            m_writer.write(out, tsPacket);
+            tsPacket = m_packets.get();
+        }
+        m_packets.release(tsPacket);
+
+        this->activeSources = 0;
+        std::string message;
+        message += "all files at their end for: \"";
+        message += this->name();
+        message += "\".";
+        SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+    }
+
+    SC_CTOR(RemuxMpts) {
+        this->loadConfig();
+        m_packets.setAccount(AllocationTracker::getInstance().account(this->name()));
+        SC_THREAD(remux);
+    }
+};
+#undef MODULE_ID_STR
+#endif //REMUXMPTS_H_
@@ -44,7 +44,7 @@ SC_MODULE(Sync)
 public:
     sc_port<BufferPictureInIf> frameIn;
     sc_in<bool> frameRequest;
-    sc_out<uint8_t*> frameOut;
+    sc_out<std::shared_ptr<uint8_t> > frameOut;
 
     sc_out<bool> stcSendRequ;
     sc_in<int64_t> stcGet;
@@ -98,7 +98,7 @@ public:
     void process()
     {
         int64_t stc = 0;
-        uint8_t* frame = NULL;
+        std::shared_ptr<uint8_t> frame;
         int size = 0;
         while(true)
         {
@@ -0,0 +1,204 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * this element generates a synthetic transport stream in memory, instead of reading a file (see TsSynthesizer.h).
+ * It is plugged into the pipeline like the TunerDVB, and sends the packets with the constant "bitRate".
+ *
+ * So throughput and scaling tests don't need the reference streams, and are reproducible with "seed".
+ * All other keys are optional, and named like the members of TsSynthesizerConfig.
+ */
+
+#ifndef TSGENERATOR_H_
+#define TSGENERATOR_H_
+
+#include <modules/elements/buffers/BufferFill.h>
+#include <modules/elements/buffers/PacketPool.h>
+#include <modules/elements/input/TsSynthesizer.h>
+#include "systemc.h"
+#include "framework/DecoupledWriter.h"
+#include "framework/Configuration.h"
+#include "rapidjson/document.h"
+#include "framework/CsvTrace.h"
+#include "framework/AllocationTracker.h"
+#include "mpeg/ts.h"
+#include <string>
+#include <memory>
+
+#define MODULE_ID_STR "/digisoft/simulator/modules/elements/TsGenerator"
+
+SC_MODULE(TsGenerator)
+{
+public:
+    sc_port<BufferFillOutIf> out;
+    unsigned long frames = 0;
+
+private:
+    std::shared_ptr<CsvTrace> m_csvTrace;
+    DecoupledWriter m_writer;
+    TsSynthesizerConfig m_config;
+    TsSynthesizer m_synthesizer;
+    PacketPool m_packets;
+    double readTimeOut;
+
+    /** @brief read an optional number out of the configuration
+     *
+     * @param s the rapidJson value
+     * @param id name of the key
+     * @param value is only changed, if the key exists
+     * @param min smallest allowed value
+     */
+    void parseNumber(rapidjson::Value& s, const char* id, double& value, double min)
+    {
+        if (!s.HasMember(id)) {
+            return;
+        }
+        if (!s[id].IsNumber() || s[id].GetDouble() < min) {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += this->name();
+            message += "\". \"";
+            message += id;
+            message += "\" is no Number or smaller than ";
+            message += std::to_string(min);
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+        value = s[id].GetDouble();
+    }
+
+    /** @brief read an optional int out of the configuration, see parseNumber()
+     */
+    void parseInt(rapidjson::Value& s, const char* id, int& value, int min, int max)
+    {
+        if (!s.HasMember(id)) {
+            return;
+        }
+        if (!s[id].IsInt() || s[id].GetInt() < min || s[id].GetInt() > max) {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += this->name();
+            message += "\". \"";
+            message += id;
+            message += "\" is no Int between ";
+            message += std::to_string(min);
+            message += " and ";
+            message += std::to_string(max);
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+        value = s[id].GetInt();
+    }
+
+public:
+    void loadConfig() {
+        Configuration& config = Configuration::getInstance();
+
+        if (!config.HasMember(this->name())) {
+            std::string message;
+            message += "No Configuration found for: \"";
+            message += this->name();
+            message += "\"";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        rapidjson::Value& s = config[this->name()];
+
+        if (!s.HasMember("bitRate") || !s["bitRate"].IsNumber() || s["bitRate"].GetDouble() <= 0) {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += this->name();
+            message += "\". \"bitRate\" is missing or no positive Number";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        m_config.bitRate = s["bitRate"].GetDouble();
+        m_config.videoBitRate = m_config.bitRate * 0.6;
+        int seed = m_config.seed;
+
+        parseInt(s, "videoPid", m_config.videoPid, 0x10, 0x1ffe);
+        parseInt(s, "audioPid", m_config.audioPid, 0x10, 0x1ffe);
+        m_config.pcrPid = m_config.videoPid;
+        parseInt(s, "pcrPid", m_config.pcrPid, 0x10, 0x1ffe);
+        parseInt(s, "pmtPid", m_config.pmtPid, 0x10, 0x1ffe);
+        parseInt(s, "programNumber", m_config.programNumber, 1, 0xffff);
+        parseInt(s, "videoStreamType", m_config.videoStreamType, 0, 0xff);
+        parseInt(s, "audioStreamType", m_config.audioStreamType, 0, 0xff);
+        parseNumber(s, "videoBitRate", m_config.videoBitRate, 0);
+        parseNumber(s, "frameRate", m_config.frameRate, 1);
+        parseInt(s, "gopSize", m_config.gopSize, 1, 10000);
+        m_config.gopSizeMax = m_config.gopSize;
+        parseInt(s, "gopSizeMax", m_config.gopSizeMax, m_config.gopSize, 10000);
+        parseNumber(s, "iFrameRatio", m_config.iFrameRatio, 1);
+        parseNumber(s, "sizeDeviation", m_config.sizeDeviation, 0);
+        parseNumber(s, "audioBitRate", m_config.audioBitRate, 0);
+        parseNumber(s, "audioFrameDuration", m_config.audioFrameDuration, 0.001);
+        parseNumber(s, "pcrInterval", m_config.pcrInterval, 0.001);
+        parseNumber(s, "psiInterval", m_config.psiInterval, 0.001);
+        parseNumber(s, "ptsDelay", m_config.ptsDelay, 0);
+        parseInt(s, "seed", seed, 0, 0x7fffffff);
+        m_config.seed = seed;
+
+        if (m_config.videoBitRate + m_config.audioBitRate > m_config.bitRate) {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += this->name();
+            message += "\". \"videoBitRate\" and \"audioBitRate\" are larger than \"bitRate\"";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        this->readTimeOut = TS_SIZE / (m_config.bitRate/8);
+
+        if (!s.HasMember("trace") || !s["trace"].IsBool()) {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"trace\" is missing or no Bool. This Module will not been logged";
+            SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+        } else {
+            if (s["trace"].GetBool()) {
+                m_csvTrace = std::make_shared<CsvTrace>(config.dir());
+                m_csvTrace->delta_cycles(true);
+                m_csvTrace->trace(this->frames, std::string(this->name()).append(".frames"), "video frames generated");
+            }
+        }
+    }
+
+    void generate() {
+        out->setPacketOwner(&m_packets);
+        m_synthesizer.setup(m_config);
+
+        while (true) {
+            uint8_t* tsPacket = m_packets.get();
+            m_synthesizer.next(tsPacket);
+            this->frames = m_synthesizer.frames();
+            m_writer.write(out, tsPacket);
+            m_writer.advance(this->readTimeOut);
+        }
+    }
+
+    SC_CTOR(TsGenerator) {
+        this->loadConfig();
+        m_packets.setAccount(AllocationTracker::getInstance().account(this->name()));
+        SC_THREAD(generate);
+    }
+};
+#undef MODULE_ID_STR
+#endif //TSGENERATOR_H_
@@ -22,20 +22,44 @@
  * THE SOFTWARE.
  *
  * This model simulates the behaviour of a DVB tuner. It reads 188 Byte packages from a TS file, and feed them with a constant rate (bitrate)
- * into the next Model, a Buffer.
+ * into the next Model, a Buffer. With "packetFormat" 192 byte M2TS or 204 byte packets are read instead, see TsPacketFormat.h.
+ * Then "bitRate" is the rate of the file, including the additional bytes.
  * It looks for a TS Sync Byte, before it sends the package.
+ *
+ * The file is either read with an ifstream ("inputMode": "stream", the default), mapped into memory
+ * ("inputMode": "mmap"), or read ahead by a host thread ("inputMode": "readAhead"). When mapped, the packets
+ * handed to the buffer are views into the file, and simulations running on the same file share the page cache.
+ *
+ * With "pacing": "pcr" the packets are not sent with the constant bitrate, but with the rate given by the PCRs
+ * on "pcrPid" (for VBR or stat muxed streams). All packets between two PCRs are sent as one burst, followed by
+ * one wait till the next PCR. With "pacing": "pcrSpread" each packet is sent at its own interpolated time between
+ * the two PCRs instead, which gives the exact arrival profile, at the cost of one wait per packet. Before the first
+ * PCR, after the last one and at discontinuities the bitrate is used.
+ *
+ * With "startTime" (seconds since the first PCR) reading starts at the last random access point, at least "preRoll"
+ * seconds before. The positions are taken from a sidecar index, built on the first use, see TsStartTime.h.
  */
 
 #ifndef READTS_H_
 #define READTS_H_
 
 #include <modules/elements/buffers/BufferFill.h>
+#include <modules/elements/buffers/PacketPool.h>
+#include <modules/elements/input/TsInputFactory.h>
+#include <modules/elements/input/TsSync.h>
+#include <modules/elements/input/TsPacketFormat.h>
+#include <modules/elements/input/TsPcrIndex.h>
+#include <modules/elements/input/TsStartTime.h>
+#include <modules/elements/input/TsLoopRewriter.h>
 #include "systemc.h"
+#include "framework/DecoupledWriter.h"
 #include "framework/Configuration.h"
 #include "rapidjson/document.h"
 #include "framework/CsvTrace.h"
+#include "framework/AllocationTracker.h"
 #include "mpeg/ts.h"
 #include <string>
+#include <cstring>
 #include <fstream>
 #include <memory>
 
@@ -49,8 +73,25 @@ public:
 private:
     std::shared_ptr<CsvTrace> m_csvTrace;
     std::string filename;
+    std::string inputMode = "stream";
+    std::shared_ptr<TsInput> m_input;
+    DecoupledWriter m_writer;
+    TsPacketFormat packetFormat = TS_PACKET_FORMAT_TS;
+    int syncLock = TS_SYNC_LOCK_COUNT;
+    unsigned long skippedBytes = 0;
     double bitRate;
     double readTimeOut;
+    bool pcrPacing = false;
+    bool pcrSpread = false; /** "pcrSpread": one wait per packet, instead of one per PCR interval */
+    int pcrPid = -1;
+    TsStartTime start;
+    uint64_t startOffset = 0;
+    TsPcrIndex m_pcrIndex;
+    int burstSize = 0;
+    bool loop = false;
+    TsLoopRewriter m_loopRewriter;
+    PacketPool m_loopPackets{TS_PACKET_FORMAT_MAX_SIZE};
+    unsigned long loops = 0;
 
 public:
     void loadConfig() {
@@ -85,8 +126,104 @@ public:
         }
 
         this->bitRate = s["bitRate"].GetDouble();
-        this->readTimeOut = 188 / (this->bitRate/8);
 
+        if (s.HasMember("packetFormat")) {
+            if (!s["packetFormat"].IsString() || !tsPacketFormatFromString(s["packetFormat"].GetString(), this->packetFormat)) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"packetFormat\" is no String or unknown";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+        }
+
+        this->readTimeOut = tsPacketFormatSize(this->packetFormat) / (this->bitRate/8);
+
+        if (s.HasMember("inputMode")) {
+            if (!s["inputMode"].IsString()) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"inputMode\" is no String";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->inputMode = s["inputMode"].GetString();
+        }
+
+        m_input = createTsInput(this->inputMode);
+        if (!m_input) {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += this->name();
+            message += "\". unknown \"inputMode\": ";
+            message += this->inputMode;
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        if (s.HasMember("syncLock")) {
+            if (!s["syncLock"].IsInt() || s["syncLock"].GetInt() < 1) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"syncLock\" is no Int greater than 0";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->syncLock = s["syncLock"].GetInt();
+        }
+
+        if (s.HasMember("pacing")) {
+            if (!s["pacing"].IsString()) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"pacing\" is no String";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            std::string pacing = s["pacing"].GetString();
+            if (pacing == "pcr") {
+                this->pcrPacing = true;
+            } else if (pacing == "pcrSpread") {
+                this->pcrPacing = true;
+                this->pcrSpread = true;
+            } else if (pacing != "constant") {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". unknown \"pacing\": ";
+                message += pacing;
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+        }
+
+        if (s.HasMember("pcrPid")) {
+            if (!s["pcrPid"].IsInt()) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"pcrPid\" is no Int";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->pcrPid = s["pcrPid"].GetInt();
+        } else if (this->pcrPacing) {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += this->name();
+            message += "\". \"pcrPid\" is missing, but needed for \"pacing\": pcr or pcrSpread";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        this->start.loadConfig(s, this->name(), MODULE_ID_STR);
+
+        if (s.HasMember("loop")) {
+            if (!s["loop"].IsBool()) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += this->name();
+                message += "\". \"loop\" is no Bool";
+                SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+            }
+            this->loop = s["loop"].GetBool();
+        }
 
         if (!s.HasMember("trace") || !s["trace"].IsBool()) {
             std::string message;
@@ -98,63 +235,174 @@ public:
             if (s["trace"].GetBool()) {
                 m_csvTrace = std::make_shared<CsvTrace>(config.dir());
                 m_csvTrace->delta_cycles(true);
-                /*nothing to Trace
-                 * use
-                 * m_csvTrace->trace(variable,file ending,ylable)
-                 * to trace a property
-                 * */
+                m_csvTrace->trace(this->skippedBytes, std::string(this->name()).append(".skippedBytes"), "bytes skipped to find the sync byte");
+                m_csvTrace->trace(this->burstSize, std::string(this->name()).append(".burstSize"), "packets sent between two PCRs");
+                m_csvTrace->trace(this->loops, std::string(this->name()).append(".loops"), "passes through the file finished");
             }
         }
     }
 
+    /** @brief tell the demux the layout of the packets, before it starts reading.
+     */
+    void start_of_simulation() {
+        out->setPacketFormat(this->packetFormat);
+    }
+
     void read() {
-        int search = 0;
-        char* tsPacket;
-        ifstream file;
-        file.open(this->filename, ifstream::in | ifstream::binary );
+        this->startOffset = this->start.findOffset(this->filename, this->packetFormat, this->pcrPid, this->syncLock,
+                                                   this->name(), MODULE_ID_STR);
 
-        while (true) {
-            tsPacket = new char[188];
-            file.read(tsPacket, 188);
+        if (!m_input->open(this->filename, this->startOffset)) {
+            std::string message;
+            message += "could not open \"";
+            message += this->filename;
+            message += "\" for: \"";
+            message += this->name();
+            message += "\".";
+            SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+            return;
+        }
+        // looped packets are rewritten, so they are copies out of an own pool
+        out->setPacketOwner(this->loop ? (BufferFillPacketOwnerIf*)&m_loopPackets : m_input.get());
 
-            if (!file) {
-                std::string message;
-                message += "file Error (Maybe end of file reached) for: \"";
-                message += this->name();
-                message += "\".";
-                SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+        switch (this->packetFormat) {
+            case TS_PACKET_FORMAT_M2TS:
+                readPackets<TsFormatM2ts>();
+                break;
+            case TS_PACKET_FORMAT_TS204:
+                readPackets<TsFormatTs204>();
                 break;
+            default:
+                readPackets<TsFormatTs>();
+        }
+    }
+
+    /** @brief copy a packet taken from the input and shift it to the current pass, for "loop".
+     *
+     * @return the copy, out of m_loopPackets
+     */
+    template<class Format>
+    uint8_t* loopPacket(uint8_t* tsPacket) {
+        uint8_t* copy = m_loopPackets.get();
+        memcpy(copy, tsPacket, Format::packetSize);
+        m_input->release(tsPacket);
+        m_loopRewriter.rewrite(copy + Format::headerOffset);
+        return copy;
+    }
+
+    /** @brief start the file again, for "loop".
+     *
+     * @param passPackets packets read in the pass that just ended
+     *
+     * @return false if the file can't be played again
+     */
+    bool rewind(uint64_t passPackets) {
+        if (passPackets == 0 || !m_input->open(this->filename, this->startOffset)) {
+            return false;
+        }
+        m_loopRewriter.rewind(passPackets * this->readTimeOut);
+        this->loops = m_loopRewriter.loops();
+        return true;
+    }
+
+    /** @brief the read loop, for one packet format.
+     *
+     * @tparam Format TsPacketLayout of the file
+     */
+    template<class Format>
+    void readPackets() {
+        uint8_t* tsPacket;
+        const uint8_t* data;
+        uint64_t offset = this->startOffset; // position of the next packet in the file
+        uint64_t intervalBegin = 0;
+        uint64_t intervalEnd = 0;
+        double intervalDuration = 0;
+        double intervalTime = 0; // time already passed in the PCR interval
+        bool inInterval = false;
+        int intervalCount = 0;
+        uint64_t passPackets = 0;
+
+        if (this->pcrPacing) {
+            if (!m_pcrIndex.build(this->filename, Format::packetSize, Format::headerOffset, this->pcrPid, this->syncLock)) {
+                SC_REPORT_WARNING(MODULE_ID_STR, "could not scan the file for PCRs, using the bitRate");
+            } else if (m_pcrIndex.size() == 0) {
+                SC_REPORT_WARNING(MODULE_ID_STR, "no PCRs found on the pcrPid, using the bitRate");
             }
+        }
 
-            while (!ts_validate((uint8_t*)tsPacket))
-            {
-                if (search == 0)
-                {
-                    SC_REPORT_WARNING(MODULE_ID_STR,"invalid tsPacket, trying to find sync byte");
-                }
-                file.seekg(-187, ios_base::cur);
-                file.read(tsPacket, 188);
-                search ++;
-            }
-            if (search != 0)
+        while (true) {
+            if (m_input->peek(data, Format::packetSize) == Format::packetSize && !ts_validate(data + Format::headerOffset))
             {
+                SC_REPORT_WARNING(MODULE_ID_STR,"invalid tsPacket, trying to find sync byte");
+                size_t search = tsResync(*m_input, Format::packetSize, this->syncLock, Format::headerOffset);
+                this->skippedBytes += search;
+                offset += search;
+
                 std::string message;
                 message += "sync byte found ";
                 message += std::to_string(search);
                 message += " bytes Later.";
                 SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
-                search = 0;
             }
 
-            out->write((uint8_t*) tsPacket);
-            wait(this->readTimeOut, SC_SEC);
-        }
+            tsPacket = m_input->take(Format::packetSize);
+
+            if (!tsPacket && this->loop && rewind(passPackets)) {
+                offset = this->startOffset;
+                passPackets = 0;
+                // a PCR interval can't reach over the end of the file
+                inInterval = false;
+                intervalCount = 0;
+                continue;
+            }
 
-        file.close();
+            if (!tsPacket) {
+                std::string message;
+                message += "file Error (Maybe end of file reached) for: \"";
+                message += this->name();
+                message += "\".";
+                SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+                break;
+            }
+
+            if (this->pcrPacing && !inInterval) {
+                inInterval = m_pcrIndex.interval(offset, intervalBegin, intervalEnd, intervalDuration);
+                intervalTime = 0;
+            }
+            if (inInterval && this->pcrSpread) {
+                // the packet arrives at its position inside the interval
+                double time = (double)(offset - intervalBegin) / (intervalEnd - intervalBegin) * intervalDuration;
+                m_writer.advance(time - intervalTime);
+                intervalTime = time;
+            }
+
+            if (this->loop) {
+                tsPacket = loopPacket<Format>(tsPacket);
+            }
+
+            m_writer.write(out, tsPacket);
+            offset += Format::packetSize;
+            passPackets++;
+
+            if (!inInterval) {
+                m_writer.advance(this->readTimeOut);
+            } else if (offset >= intervalEnd) {
+                // last packet before the next PCR, the burst (or the rest of the interval) takes till the next PCR
+                this->burstSize = intervalCount + 1;
+                intervalCount = 0;
+                inInterval = false;
+                m_writer.advance(intervalDuration - intervalTime);
+            } else {
+                intervalCount++;
+            }
+        }
     }
 
     SC_CTOR(TunerDVB) {
         this->loadConfig();
+        std::shared_ptr<AllocationAccount> account = AllocationTracker::getInstance().account(this->name());
+        m_input->setAccount(account);
+        m_loopPackets.setAccount(account);
         SC_THREAD(read);
     }
 };
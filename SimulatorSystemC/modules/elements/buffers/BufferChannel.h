@@ -0,0 +1,489 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file generic buffer channel, with the storage strategy chosen by template policies.
+ *
+ * BufferChannel implements storage, capacity accounting, blocking, watermarks and tracing once for the
+ * buffers of the pipeline (BufferFiFo and BufferDecoder are built on it), and is configured at compile time
+ * with:
+ *     Element   the payload, moved into and out of the channel (e.g. std::shared_ptr<uint8_t>,
+ *               std::unique_ptr<uint8_t[]>)
+ *     Capacity  what "size" counts: CapacityElements or CapacityBytes
+ *     Ordering  in which order the elements are read: OrderFifo, OrderRing (write order from slots preallocated
+ *               for "size" elements), or OrderKey (smallest key, e.g. pts, first)
+ *     Release   when the capacity of a read element is free again: ReleaseOnRead, or ReleaseOnDrop (when the
+ *               reader drops the element, only for std::shared_ptr elements)
+ *
+ * The policies are plain structs with static or inline members, so the read and write paths are resolved
+ * and inlined at compile time. Only calls through a sc_port go through the virtual interface.
+ *
+ * Like the other buffers it reads "size", "trace" and the optional watermarks (see Watermarks.h) from the
+ * configuration of its name. The sizes of the elements it holds are counted in the memory model
+ * (see MemoryModel.h). With setPool() the element sizes in bytes are allocated from a SharedMemoryPool
+ * instead, "size" is then the share of the buffer in the pool. underruns counts how often the reader found
+ * the channel empty, after the first element.
+ *
+ * e.g. a byte counted decoder buffer, that is full till the decoder is done with a frame:
+ *     BufferChannel<std::shared_ptr<uint8_t>, CapacityBytes, OrderFifo, ReleaseOnDrop> buffer("buffer");
+ */
+
+#ifndef BUFFERS_BUFFERCHANNEL_H_
+#define BUFFERS_BUFFERCHANNEL_H_
+
+#include "systemc.h"
+#include "framework/Configuration.h"
+#include "framework/CsvTrace.h"
+#include "framework/MemoryModel.h"
+#include <modules/elements/buffers/Watermarks.h>
+#include <modules/elements/buffers/SharedMemoryPool.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#define MODULE_ID_STR "/digisoft/simulator/modules/elements/buffers/BufferChannel"
+
+template<class Element>
+class BufferChannelOutIf :  virtual public sc_interface {
+public:
+    virtual void write(Element, int64_t key, int size) = 0;      // blocking write
+    virtual bool nbwrite(Element&, int64_t key, int size) = 0;   // noblocking write, takes the element only on success
+    virtual void waitLowWatermark() = 0;                         // block till fill is at or below the low watermark
+    virtual const sc_event& lowWatermarkEvent() const = 0;
+protected:
+    BufferChannelOutIf() {
+    };
+private:
+    BufferChannelOutIf (const BufferChannelOutIf&);      // disable copy
+    BufferChannelOutIf& operator= (const BufferChannelOutIf&); // disable
+};
+
+template<class Element>
+class BufferChannelInIf :  virtual public sc_interface {
+public:
+    virtual void read(Element&, int64_t& key, int& size) = 0;    // blocking read
+    virtual bool nbread(Element&, int64_t& key, int& size) = 0;  // noblocking read
+    virtual void waitHighWatermark() = 0;                        // block till fill is at or above the high watermark, see Watermarks.h
+    virtual const sc_event& highWatermarkEvent() const = 0;
+protected:
+    BufferChannelInIf() {
+    };
+private:
+    BufferChannelInIf (const BufferChannelInIf&);            // disable copy
+    BufferChannelInIf& operator= (const BufferChannelInIf&); // disable =
+};
+
+/** @brief capacity policy: "size" is the amount of elements */
+struct CapacityElements {
+    static int cost(int) {
+        return 1;
+    }
+    static const char* unit() {
+        return "fill in elements";
+    }
+};
+
+/** @brief capacity policy: "size" is the sum of the element sizes in bytes */
+struct CapacityBytes {
+    static int cost(int size) {
+        return size;
+    }
+    static const char* unit() {
+        return "fill in Bytes";
+    }
+};
+
+/** @brief ordering policy: read in write order */
+template<class Entry>
+class OrderFifo {
+public:
+    void reserve(int) {
+    }
+    void push(Entry&& entry) {
+        m_entries.push_back(std::move(entry));
+    }
+    bool empty() const {
+        return m_entries.empty();
+    }
+    Entry& front() {
+        return m_entries.front();
+    }
+    void pop() {
+        m_entries.pop_front();
+    }
+private:
+    std::deque<Entry> m_entries;
+};
+
+/** @brief ordering policy: read the element with the smallest key first. Equal keys are read in write order.
+ */
+template<class Entry>
+class OrderKey {
+public:
+    void reserve(int) {
+    }
+    void push(Entry&& entry) {
+        int64_t key = entry.key;
+        m_entries.insert(m_entries.end(), std::make_pair(key, std::move(entry)));
+    }
+    bool empty() const {
+        return m_entries.empty();
+    }
+    Entry& front() {
+        return m_entries.begin()->second;
+    }
+    void pop() {
+        m_entries.erase(m_entries.begin());
+    }
+private:
+    std::multimap<int64_t, Entry> m_entries;
+};
+
+/** @brief ordering policy: read in write order, from a ring of slots allocated once.
+ *
+ * The channel reserves a slot for each element of its "size", so with CapacityElements nothing is allocated
+ * per element. Only if more elements are stored (e.g. from a memory pool), the ring grows.
+ */
+template<class Entry>
+class OrderRing {
+public:
+    void reserve(int size) {
+        m_slots.resize(std::max(size, 1));
+    }
+    void push(Entry&& entry) {
+        if (m_count == m_slots.size()) {
+            this->grow();
+        }
+        m_slots[(m_head + m_count) % m_slots.size()] = std::move(entry);
+        m_count++;
+    }
+    bool empty() const {
+        return m_count == 0;
+    }
+    Entry& front() {
+        return m_slots[m_head];
+    }
+    void pop() {
+        m_slots[m_head] = Entry();
+        m_head = (m_head + 1) % m_slots.size();
+        m_count--;
+    }
+private:
+    void grow() {
+        std::vector<Entry> slots(std::max<size_t>(2 * m_slots.size(), 1));
+        for (size_t i = 0; i < m_count; i++) {
+            slots[i] = std::move(m_slots[(m_head + i) % m_slots.size()]);
+        }
+        m_slots.swap(slots);
+        m_head = 0;
+    }
+
+    std::vector<Entry> m_slots;
+    size_t m_head = 0;
+    size_t m_count = 0;
+};
+
+/** @brief release policy: the capacity of an element is free, as soon as it is read */
+struct ReleaseOnRead {
+    template<class Channel, class Element>
+    static void handOut(Channel& channel, Element&, int size) {
+        channel.give(size);
+    }
+};
+
+/** @brief release policy: the capacity of an element is free, when the reader drops its last reference.
+ *
+ * The element handed to the reader shares ownership with the stored one, and gives the capacity back from
+ * its deleter. The channel may be gone by then.
+ */
+struct ReleaseOnDrop {
+    template<class Channel, class T>
+    static void handOut(Channel& channel, std::shared_ptr<T>& element, int size) {
+        std::shared_ptr<T> held = std::move(element);
+        std::shared_ptr<typename Channel::Account> account = channel.account();
+        T* data = held.get();
+        element = std::shared_ptr<T>(data, [held, account, size](T*) {
+            if (account->owner) {
+                account->owner->give(size);
+            }
+        });
+    }
+};
+
+template<class Element,
+         class Capacity = CapacityElements,
+         template<class> class Ordering = OrderFifo,
+         class Release = ReleaseOnRead>
+class BufferChannel
+    : public sc_core::sc_prim_channel
+    , public virtual BufferChannelOutIf<Element>
+    , public virtual BufferChannelInIf<Element> {
+public:
+    /** @brief link of the elements handed out with ReleaseOnDrop back to the channel */
+    struct Account {
+        BufferChannel* owner;
+    };
+
+    explicit BufferChannel(const char* name):
+        sc_prim_channel(name),
+        m_account(std::make_shared<Account>())
+    {
+        m_account->owner = this;
+        m_region = MemoryModel::getInstance().region(this->name());
+        this->loadConfig();
+    }
+
+    virtual ~BufferChannel() {
+        // elements still held by the reader must not call back
+        m_account->owner = NULL;
+    }
+
+    /** @brief store an element, blocks till there is space for it.
+     *
+     * An element larger than the whole buffer is stored, when the buffer is empty.
+     *
+     * @param element moved into the channel
+     * @param key pts or any other value handed to the reader, the order of OrderKey
+     * @param size size of the element in bytes
+     */
+    void write(Element element, int64_t key, int size) {
+        while (!this->reserve(size)) {
+            this->waitForSpace();
+        }
+        this->push(element, key, size);
+    }
+
+    /** @brief store an element, if there is space for it.
+     *
+     * @return true if the element is stored. Otherwise element is unchanged.
+     */
+    bool nbwrite(Element& element, int64_t key, int size) {
+        if (!this->reserve(size)) {
+            return false;
+        }
+        this->push(element, key, size);
+        return true;
+    }
+
+    /** @brief take the next element out of the channel, blocks while it is empty.
+     */
+    void read(Element& element, int64_t& key, int& size) {
+        while (m_entries.empty()) {
+            this->waitForData();
+        }
+        this->pop(element, key, size);
+    }
+
+    /** @brief take the next element out of the channel.
+     *
+     * @return false if the channel is empty. Then nothing is changed.
+     */
+    bool nbread(Element& element, int64_t& key, int& size) {
+        if (m_entries.empty()) {
+            return false;
+        }
+        this->pop(element, key, size);
+        return true;
+    }
+
+    /** @brief give the capacity of an element of size bytes back, called by the release policy.
+     */
+    void give(int size) {
+        this->setFill(fill - Capacity::cost(size), m_bytes - size);
+        if (m_pool) {
+            m_pool->free(m_poolClient, size);
+        }
+        m_dataReadEvent.notify();
+    }
+
+    /** @brief allocate the elements from pool, instead of the own size. Call it during elaboration.
+     */
+    void setPool(SharedMemoryPoolIf* pool) {
+        m_pool = pool;
+        m_poolClient = m_pool->attach(this->name(), m_size);
+    }
+
+    void waitHighWatermark() {
+        m_watermarks.waitHigh(fill);
+    }
+
+    void waitLowWatermark() {
+        m_watermarks.waitLow(fill);
+    }
+
+    const sc_event& highWatermarkEvent() const {
+        return m_watermarks.highEvent();
+    }
+
+    const sc_event& lowWatermarkEvent() const {
+        return m_watermarks.lowEvent();
+    }
+
+    std::shared_ptr<Account> account() {
+        return m_account;
+    }
+
+    int getSize() const {
+        return m_size;
+    }
+
+    int fill = 0;      /** in the unit of Capacity, includes read elements that are not released yet */
+    int elements = 0;  /** stored and not read yet */
+    int underruns = 0; /** reads from the empty channel, after the first element */
+
+protected:
+    /** @brief change fill and the bytes held, and notify the watermark events fill crosses */
+    void setFill(int fill, unsigned long bytes) {
+        int before = this->fill;
+        this->fill = fill;
+        m_watermarks.update(before, fill);
+        m_bytes = bytes;
+        m_region->set(m_bytes);
+    }
+
+    /** @brief block till an element is written. Once the reader started this is an underrun: it is counted,
+     * and the reader waits for the high watermark again, like at the start.
+     */
+    void waitForData() {
+        if (m_started) {
+            this->underruns++;
+            if (m_pool) {
+                m_pool->underrun(m_poolClient);
+            }
+            m_watermarks.waitHigh(fill);
+            if (this->elements > 0) {
+                return;
+            }
+        }
+        wait(m_dataWriteEvent);
+    }
+
+    /** @brief block till capacity is given back. Meanwhile a reader waiting for the high watermark goes on,
+     * the channel can't get fuller.
+     */
+    void waitForSpace() {
+        m_watermarks.writerBlocked(true);
+        wait(m_pool ? m_pool->freeEvent() : m_dataReadEvent);
+        m_watermarks.writerBlocked(false);
+    }
+
+    /** @brief take the capacity for an element of size bytes, if there is space for it */
+    bool reserve(int size) {
+        if (m_pool) {
+            return m_pool->allocate(m_poolClient, size);
+        }
+        return fill == 0 || fill + Capacity::cost(size) <= m_size;
+    }
+
+    /** @brief store an element, its capacity is reserved */
+    void push(Element& element, int64_t key, int size) {
+        m_entries.push(Entry{std::move(element), key, size});
+        this->setFill(fill + Capacity::cost(size), m_bytes + size);
+        elements++;
+        m_dataWriteEvent.notify();
+    }
+
+    int m_size;
+    sc_event m_dataReadEvent;
+    sc_event m_dataWriteEvent;
+    bool m_started = false; /** an element was read */
+
+private:
+    struct Entry {
+        Element element;
+        int64_t key;
+        int size;
+    };
+
+    void loadConfig() {
+        Configuration& config = Configuration::getInstance();
+
+        if (!config.HasMember(this->name())) {
+            std::string message;
+            message += "No Configuration found for: \"";
+            message += this->name();
+            message += "\"";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        rapidjson::Value& s = config[this->name()];
+
+        if (!s.HasMember("size") || !s["size"].IsInt()) {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"size\" is missing or no Int";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+
+        this->m_size = s["size"].GetInt();
+        m_entries.reserve(this->m_size);
+
+        m_watermarks.loadConfig(s, this->name(), MODULE_ID_STR, this->m_size);
+
+        if (!s.HasMember("trace") || !s["trace"].IsBool()) {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"trace\" is missing or no Bool. This Module will not been logged";
+            SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+        } else {
+            if (s["trace"].GetBool()) {
+                m_csvTrace = std::make_shared<CsvTrace>(config.dir());
+                m_csvTrace->delta_cycles(true);
+                m_csvTrace->trace(this->fill, std::string(this->name()).append(".fill"), Capacity::unit());
+                m_csvTrace->trace(this->elements, std::string(this->name()).append(".elements"), "elements stored");
+                m_csvTrace->trace(this->underruns, std::string(this->name()).append(".underruns"), "reads from the empty buffer");
+            }
+        }
+    }
+
+    void pop(Element& element, int64_t& key, int& size) {
+        Entry& entry = m_entries.front();
+        element = std::move(entry.element);
+        key = entry.key;
+        size = entry.size;
+        m_entries.pop();
+        elements--;
+        m_started = true;
+        Release::handOut(*this, element, size);
+    }
+
+    Ordering<Entry> m_entries;
+    std::shared_ptr<Account> m_account;
+
+    Watermarks m_watermarks;
+    unsigned long m_bytes = 0; /** sizes of the elements, that are not released yet */
+    std::shared_ptr<MemoryRegion> m_region;
+    SharedMemoryPoolIf* m_pool = NULL;
+    int m_poolClient = 0;
+
+    std::shared_ptr<CsvTrace> m_csvTrace;
+};
+
+#undef MODULE_ID_STR
+#endif /* BUFFERS_BUFFERCHANNEL_H_ */
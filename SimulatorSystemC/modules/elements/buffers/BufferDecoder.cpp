@@ -30,69 +30,47 @@
 #include "BufferDecoder.h"
 
 #include "framework/Configuration.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
 
 #define MODULE_ID_STR "/digisoft/simulator/modules/elements/buffers/BufferVideoDecoder"
 
 BufferDecoder::BufferDecoder(const char* name)
-    : sc_prim_channel(name)
+    : Channel(name)
 {
     this->loadConfig();
-    this->reset();
 }
 
-/** @brief this function loads the confguration
+/** @brief this function loads the "storage", the rest of the configuration is loaded by BufferChannel
  *
  */
 void BufferDecoder::loadConfig()
 {
-    Configuration& config = Configuration::getInstance();
-
-    if (!config.HasMember(this->name())) {
-        std::string message;
-        message += "No Configuration found for: \"";
-        message += this->name();
-        message += "\"";
-        SC_REPORT_FATAL(MODULE_ID_STR , message.c_str());
-    }
-
-    rapidjson::Value& s = config[this->name()];
-
-    if (!s.HasMember("size") || !s["size"].IsInt()) {
-        std::string message;
-        message += "Malformed configuration of \"";
-        message += this->name();
-        message += "\". \"size\" is missing or no Int";
-        SC_REPORT_FATAL(MODULE_ID_STR , message.c_str());
-    }
-
-    this->m_size = s["size"].GetInt();
-
-    if (!s.HasMember("trace") || !s["trace"].IsBool()) {
-        std::string message;
-        message += "Malformed configuration of \"";
-        message += this->name();
-        message += "\". \"trace\" is missing or no Bool. This Module will not been logged";
-        SC_REPORT_WARNING(MODULE_ID_STR , message.c_str());
-    } else {
-        if (s["trace"].GetBool()) {
-            m_csvTrace = std::make_shared<CsvTrace>(config.dir());
-            m_csvTrace->delta_cycles(true);
-            m_csvTrace->trace(this->fill, std::string(this->name()).append(".fill"), "fill in Bytes");
+    rapidjson::Value& s = Configuration::getInstance()[this->name()];
+
+    if (s.HasMember("storage")) {
+        std::string storage = s["storage"].IsString() ? s["storage"].GetString() : "";
+        if (storage == "ring") {
+            m_ring = std::make_shared<Ring>(std::max(this->m_size, 0));
+            m_ring->owner = this;
+            m_ring->account = AllocationTracker::getInstance().account(this->name());
+            m_ring->account->allocate(m_ring->bytes.size());
+        } else if (storage != "reference") {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"storage\" is no String, or not \"reference\" or \"ring\"";
+            SC_REPORT_FATAL(MODULE_ID_STR , message.c_str());
         }
     }
 }
 
 BufferDecoder::~BufferDecoder() {
-}
-
-/** @brief reset the Buffer
- *
- */
-void BufferDecoder::reset()
-{
-    fill = 0;
-    m_bitstreamBuffer.empty();
-    m_ptsBuffer.empty();
+    if (m_ring) {
+        // frames still held by others must not call back
+        m_ring->owner = NULL;
+    }
 }
 
 /** @brief write a element in the buffer
@@ -100,71 +78,166 @@ void BufferDecoder::reset()
  * This function saves an element in the Buffer. It will save the pts and the size as well.
  * Size is used to calculate the filling of the Buffer.
  *
+ * With "storage": "ring" it blocks till there is contiguous space for the element in the ring.
+ *
  * @param[in] buffer element to Store (pes_payload)
  * @param[in] pts presentation time stamp according to the buffer element
  * @param[in] size is the size of the buffer
  *
  */
-void BufferDecoder::write(uint8_t* buffer, int64_t pts, int size)
+void BufferDecoder::write(std::shared_ptr<uint8_t> buffer, int64_t pts, int size)
 {
-    /**
-     * just because some data are removed, this migth not necesarry mean, that there is now enogth space
-     */
-    while (this->fill+size > this->m_size)
+    if (!m_ring)
     {
-        wait(this->m_dataReadEvent);
+        Channel::write(buffer, pts, size);
+        return;
     }
 
-    this->m_bitstreamBuffer.push_back(std::make_pair(buffer, size));
-    this->m_ptsBuffer.push_back(pts);
-    this->fill += size;
+    while (!pushRing(buffer, pts, size))
+    {
+        this->waitForSpace();
+    }
+}
 
-    this->m_dataWriteEvent.notify();
+/** @brief noblocking write
+ *
+ * @return true if the element is stored (or dropped, see pushRing()), false if there is no space for it
+ */
+bool BufferDecoder::nbwrite(std::shared_ptr<uint8_t>& buffer, int64_t pts, int size)
+{
+    if (!m_ring)
+    {
+        return Channel::nbwrite(buffer, pts, size);
+    }
+    return pushRing(buffer, pts, size);
 }
 
 /** @brief get a element from the buffer
  *
- * This function read an element from the Buffer and removes it.
+ * This function read an element from the Buffer and removes it. With "storage": "ring" the element
+ * stays in the ring till the last reference to it is dropped.
  *
  * @param[out] buffer reference to the buffer to fill.
  * @param[out] pts reference to an int64_t witch will holt the pts
  * @param[out] size of the buffer retrurned
  *
  */
-void BufferDecoder::read(uint8_t*& buffer, int64_t& pts, int& size)
+void BufferDecoder::read(std::shared_ptr<uint8_t>& buffer, int64_t& pts, int& size)
 {
-    if(m_bitstreamBuffer.empty())
+    if (!m_ring)
     {
-        wait(this->m_dataWriteEvent);
+        Channel::read(buffer, pts, size);
+        return;
     }
-    std::pair <uint8_t*, int>element = this->m_bitstreamBuffer.front();
-    buffer = element.first;
-    size = element.second;
-    pts = this->m_ptsBuffer.front();
 
-    this->m_bitstreamBuffer.pop_front();
-    this->m_ptsBuffer.pop_front();
-    this->fill -= size;
+    while (!popRing(buffer, pts, size))
+    {
+        this->waitForData();
+    }
+}
 
-    this->m_dataReadEvent.notify();
+/** @brief noblocking read
+ *
+ * @return false if the buffer is empty
+ */
+bool BufferDecoder::nbread(std::shared_ptr<uint8_t>& buffer, int64_t& pts, int& size)
+{
+    if (!m_ring)
+    {
+        return Channel::nbread(buffer, pts, size);
+    }
+    return popRing(buffer, pts, size);
 }
 
-/** @brief return the fullness of the buffer
+/** @brief copy the element into the ring, if there is contiguous space for it
  *
- * @retrun fullness of Buffer in percent
+ * Elements that never fit (empty, or larger than the ring) are dropped, and count as written.
+ */
+bool BufferDecoder::pushRing(const std::shared_ptr<uint8_t>& buffer, int64_t pts, int size)
+{
+    if (size == 0)
+    {
+        // the ring never has room for an empty element, and there is nothing to decode in it
+        return true;
+    }
+
+    if (size > this->m_size)
+    {
+        std::string message;
+        message += this->name();
+        message += ": element of ";
+        message += std::to_string(size);
+        message += " bytes is larger than the buffer, dropped";
+        SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+        return true;
+    }
+
+    uint8_t* data = m_ring->bytes.push(size, pts);
+    if (!data)
+    {
+        return false;
+    }
+    memcpy(data, buffer.get(), size);
+    this->elements++;
+    this->setFill(m_ring->bytes.used(), m_ring->bytes.used());
+
+    this->m_dataWriteEvent.notify();
+    return true;
+}
+
+/** @brief hand out the next element of the ring in place, if there is one
  *
  */
-double BufferDecoder::fillPercent()
+bool BufferDecoder::popRing(std::shared_ptr<uint8_t>& buffer, int64_t& pts, int& size)
 {
-    return (double)fill * 100 / double(m_size);
+    uint64_t id;
+    uint8_t* data;
+    if (!m_ring->bytes.pop(id, data, size, pts))
+    {
+        return false;
+    }
+    this->elements--;
+    m_started = true;
+    buffer = std::shared_ptr<uint8_t>(data, RingRelease(m_ring, id));
+    return true;
+}
+
+/** @brief give the space of a frame read out of the ring back
+ *
+ */
+void BufferDecoder::RingRelease::operator()(uint8_t*)
+{
+    ring->bytes.release(id);
+    if (ring->owner)
+    {
+        ring->owner->setFill(ring->bytes.used(), ring->bytes.used());
+        ring->owner->m_dataReadEvent.notify();
+    }
+}
+
+/** @brief allocate the frames from pool, instead of the own size. Call it during elaboration.
+ *
+ * Only with "storage": "reference", the ring is one piece of memory.
+ */
+void BufferDecoder::setPool(SharedMemoryPoolIf* pool)
+{
+    if (m_ring)
+    {
+        std::string message;
+        message += this->name();
+        message += ": a memory pool is not possible with \"storage\": \"ring\"";
+        SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+    }
+    Channel::setPool(pool);
 }
 
-/** @brief return the size of the buffer
+/** @brief return the fullness of the buffer
+ *
+ * @retrun fullness of Buffer in percent
  *
- * @return the size of the buffer
  */
-int BufferDecoder::getSize()
+double BufferDecoder::fillPercent()
 {
-    return this->m_size;
+    return (double)fill * 100 / double(m_size);
 }
 #undef MODULE_ID_STR
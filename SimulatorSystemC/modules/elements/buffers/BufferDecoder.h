@@ -24,74 +24,82 @@
  * @file Buffer to simulate the behavior of a Video Decoder buffer.
  *
  * It works as a FiFo with frames that are given. But compared to a normal FiFo the filling calculation is
- * not done by the frames that are in the Buffer, but by the size of the given frames.
+ * not done by the frames that are in the Buffer, but by the size of the given frames. It is a BufferChannel
+ * counting bytes (see BufferChannel.h), so "size", "trace", the watermarks, the memory model, the pool and
+ * the underruns are handled there.
+ *
+ * The frames are reference counted (e.g. slices of the PES arena of the demux), so they are handed on
+ * without copying, and freed or reused when the last holder drops them.
+ *
+ * With "storage": "ring" the frames are copied into a contiguous byte ring of size bytes instead, like a
+ * hardware bitstream buffer (see ByteRing.h). The reader gets the frame in place in the ring, and its space
+ * is free again when the last reference to it is dropped, so the decoders copy what they decoded into their own
+ * memory and drop the frame after decoding. fill then includes the bytes lost to wrap around.
+ * A memory pool is not possible then.
  */
 #ifndef MODULES_ELEMENTS_BUFFERS_BUFFERDECODER_H_
 #define MODULES_ELEMENTS_BUFFERS_BUFFERDECODER_H_
 
 #include "systemc.h"
-#include "framework/CsvTrace.h"
+#include "framework/AllocationTracker.h"
+#include <modules/elements/buffers/BufferChannel.h>
+#include <modules/elements/buffers/ByteRing.h>
+#include <modules/elements/buffers/SharedMemoryPool.h>
 #include <stdint.h>
-#include <list>
 #include <memory>
 
-class BufferDecoderOutIf :  virtual public sc_interface {
-public:
-    virtual void write(uint8_t*, int64_t, int) = 0;          // blocking write
-protected:
-    BufferDecoderOutIf() {
-    };
-private:
-    BufferDecoderOutIf (const BufferDecoderOutIf&);      // disable copy
-    BufferDecoderOutIf& operator= (const BufferDecoderOutIf&); // disable
-};
-
-class BufferDecoderInIf :  virtual public sc_interface {
-public:
-    virtual void read(uint8_t*&, int64_t&, int&) = 0;          // blocking read
-
-protected:
-    BufferDecoderInIf () {
-    };
-private:
-    BufferDecoderInIf (const BufferDecoderInIf&);            // disable copy
-    BufferDecoderInIf & operator= (const BufferDecoderInIf&); // disable =
-};
-
-
+typedef BufferChannelOutIf<std::shared_ptr<uint8_t> > BufferDecoderOutIf;
+typedef BufferChannelInIf<std::shared_ptr<uint8_t> > BufferDecoderInIf;
 
 class BufferDecoder
-    : public sc_core::sc_prim_channel
-    , public BufferDecoderInIf
-    , public BufferDecoderOutIf
+    : public BufferChannel<std::shared_ptr<uint8_t>, CapacityBytes, OrderFifo, ReleaseOnRead>
 {
 public:
     BufferDecoder(const char* name);
     virtual ~BufferDecoder();
 
-    void reset();
-
-    void write(uint8_t* buffer, int64_t pts, int size);
-    void read(uint8_t*& buffer, int64_t& pts, int& size);
+    void write(std::shared_ptr<uint8_t> buffer, int64_t pts, int size);
+    bool nbwrite(std::shared_ptr<uint8_t>& buffer, int64_t pts, int size);
+    void read(std::shared_ptr<uint8_t>& buffer, int64_t& pts, int& size);
+    bool nbread(std::shared_ptr<uint8_t>& buffer, int64_t& pts, int& size);
     double fillPercent();
-
-    int getSize();
-
-    int fill;
-
+    void setPool(SharedMemoryPoolIf* pool);
 
 private:
-    void loadConfig();
-
-    int m_size;                 // size
-    std::list<std::pair<uint8_t*, int>> m_bitstreamBuffer;
-    std::list<uint64_t> m_ptsBuffer;
+    typedef BufferChannel<std::shared_ptr<uint8_t>, CapacityBytes, OrderFifo, ReleaseOnRead> Channel;
+
+    /** @brief the ring of "storage": "ring", shared with the frames read out of it */
+    struct Ring {
+        explicit Ring(size_t size):
+            bytes(size)
+        {
+        };
+        ~Ring() {
+            if (account) {
+                account->free(bytes.size());
+            }
+        }
+        ByteRing bytes;
+        BufferDecoder* owner = NULL; /** NULL when the buffer is gone */
+        std::shared_ptr<AllocationAccount> account;
+    };
 
-    sc_event m_dataReadEvent;
-    sc_event m_dataWriteEvent;
+    /** @brief deleter of the frames read out of the ring */
+    struct RingRelease {
+        RingRelease(const std::shared_ptr<Ring>& ring, uint64_t id):
+            ring(ring), id(id)
+        {
+        };
+        void operator()(uint8_t*);
+        std::shared_ptr<Ring> ring;
+        uint64_t id;
+    };
 
-    std::shared_ptr<CsvTrace> m_csvTrace;
+    void loadConfig();
+    bool pushRing(const std::shared_ptr<uint8_t>& buffer, int64_t pts, int size);
+    bool popRing(std::shared_ptr<uint8_t>& buffer, int64_t& pts, int& size);
 
+    std::shared_ptr<Ring> m_ring; // only with "storage": "ring"
 };
 
 #endif /* MODULES_ELEMENTS_BUFFERS_BUFFERVIDEODECODER_H_ */
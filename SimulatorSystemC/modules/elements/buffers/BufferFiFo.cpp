@@ -1,4 +1,4 @@
-/**
+/*
  * The MIT License (MIT)
  * 
  * Copyright (c) 2015 Digisoft.tv Ltd.
@@ -27,74 +27,34 @@
 
 
 #include <modules/elements/buffers/BufferFiFo.h>
-#include "framework/Configuration.h"
-#include "bitstream/mpeg/ts.h"
+#include <cstring>
 
-#define MODULE_ID_STR "/digisoft/simulator/modules/elements/buffers/BufferFiFo"
-
-/** @brief constructor. Load the Config and reset the buffer.
+/** @brief constructor. The configuration is loaded by BufferChannel.
  *
  * @param name name of the element
  *
  */
 BufferFiFo::BufferFiFo(const char* name)
-    : sc_prim_channel(name)
+    : Channel(name)
 {
-    this->loadConfig();
-    this->reset();
 }
-/** @brief load the config from a given  .json file.
+
+/** @brief move an Element into the Buffer, without copy. It will block if the FiFo is Full.
  *
  */
-void BufferFiFo::loadConfig()
+void BufferFiFo::write(std::unique_ptr<uint8_t[]> element, int64_t key, int size)
 {
-    Configuration& config = Configuration::getInstance();
-
-    if (!config.HasMember(this->name())) {
-        std::string message;
-        message += "No Configuration found for: \"";
-        message += this->name();
-        message += "\"";
-        SC_REPORT_FATAL(MODULE_ID_STR , message.c_str());
-    }
-
-    rapidjson::Value& s = config[this->name()];
-
-    if (!s.HasMember("size") || !s["size"].IsInt()) {
-        std::string message;
-        message += "Malformed configuration of \"";
-        message += this->name();
-        message += "\". \"size\" is missing or no Int";
-        SC_REPORT_FATAL(MODULE_ID_STR , message.c_str());
-    }
-    this->size = s["size"].GetInt();
-
-    if (!s.HasMember("trace") || !s["trace"].IsBool()) {
-        std::string message;
-        message += "Malformed configuration of \"";
-        message += this->name();
-        message += "\". \"trace\" is missing or no Bool. This Module will not been logged";
-        SC_REPORT_WARNING(MODULE_ID_STR , message.c_str());
-    } else {
-        if (s["trace"].GetBool()) {
-            m_csvTrace = std::make_shared<CsvTrace>(config.dir());
-            m_csvTrace->delta_cycles(true);
-            m_csvTrace->trace(this->fill, std::string(this->name()).append(".fill"), "fill in elements");
-        }
-    }
+    Channel::write(std::move(element), key, size);
 }
 
-BufferFiFo::~BufferFiFo() {
-}
-
-/** @brief reset the Buffer
+/** @brief noblocking move of an Element into the Buffer, without copy
+ *
+ * return true if write was sucessfull. Otherwise element keeps the element.
  *
  */
-void BufferFiFo::reset()
+bool BufferFiFo::nbwrite(std::unique_ptr<uint8_t[]>& element, int64_t key, int size)
 {
-    buf.empty();
-    this->fill = 0;
-
+    return Channel::nbwrite(element, key, size);
 }
 
 /** @brief copy an Element to the Buffer
@@ -107,23 +67,15 @@ void BufferFiFo::reset()
  */
 void BufferFiFo::write(uint8_t* c, int size)
 {
-    if (this->fill+1 > this->size) {
-        wait(dataReadEvent);
-    }
-
-    uint8_t* buffToSave = new uint8_t[size];
-    memcpy(buffToSave,c,size);
-
-    buf.push_back(std::make_pair(buffToSave,size));
-    fill ++;
-    dataWriteEvent.notify();
-
+    std::unique_ptr<uint8_t[]> buffToSave(new uint8_t[size]);
+    memcpy(buffToSave.get(), c, size);
+    Channel::write(std::move(buffToSave), 0, size);
 }
 
 /** @brief noblocking write
  *
  * The function will copy an element from the position c and the size size in Memeory to the Buffer. It will not block if the FiFo is Full.
- * Intead it will return true or false if the write was sucessful
+ * Intead it will return true or false if the write was sucessful. Nothing is copied if the FiFo is full.
  *
  * @param c pointer to the element
  * @param size size of the element
@@ -131,57 +83,15 @@ void BufferFiFo::write(uint8_t* c, int size)
  * return true if write was sucessfull, false otherwise.
  *
  */
-bool BufferFiFo::nbwrite(uint8_t *c, int size)
+bool BufferFiFo::nbwrite(uint8_t* c, int size)
 {
-    if (this->fill+1 > this->size) {
+    if (!this->reserve(size)) {
         return false;
     }
 
-    uint8_t* buffToSave = new uint8_t[size];
-    memcpy(buffToSave,c,size);
-
-    buf.push_back(std::make_pair(buffToSave,size));
-    fill ++;
-    dataWriteEvent.notify();
+    std::unique_ptr<uint8_t[]> buffToSave(new uint8_t[size]);
+    memcpy(buffToSave.get(), c, size);
+    this->push(buffToSave, 0, size);
 
     return true;
 }
-
-/** @brief read an element from the FiFo
- *
- * The function will return an element from the FiFo. The caller has to care about deleting the Element.
- *
- * @param c pointer to the element
- * @param size size of the element
- */
-void BufferFiFo::read(uint8_t*& c, int &size)
-{
-    if(fill == 0)
-    {
-        wait(dataWriteEvent);
-    }
-
-    std::pair <uint8_t*,int>element = this->buf.front();
-    c = element.first;
-    size = element.second;
-    fill --;
-    this->buf.pop_front();
-
-    dataReadEvent.notify();
-}
-
-/** @brief interface to @read(uint8_t*& c, int &size)
- *
- *
- * @param size size of the element
- *
- * return pointer to the element
- */
-uint8_t* BufferFiFo::read(int &size)
-{
-    uint8_t* c;
-    read(c, size);
-    return c;
-}
-
-#undef MODULE_ID_STR
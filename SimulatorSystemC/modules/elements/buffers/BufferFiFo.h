@@ -23,72 +23,46 @@
  *
  * @BufferFiFo.h This Buffer is a Simple fifo implementation. It takes up to size elements. The size of each element is not observed.
  *
+ * It is a BufferChannel (see BufferChannel.h) counting elements, stored in a ring of size slots allocated once
+ * (OrderRing). write(uint8_t*, int) and nbwrite(uint8_t*, int) copy the element into the FiFo. With the
+ * BufferChannel write and nbwrite the element is moved in instead, and nothing is copied. The reader owns the
+ * element it reads.
+ *
+ * "highWatermark" and "lowWatermark" in elements are optional, see Watermarks.h.
+ * The memory model (see MemoryModel.h) counts the size of the stored elements.
  */
 
 #ifndef BUFFERFIFO_H_
 #define BUFFERFIFO_H_
 
-#include "systemc.h"
-#include "framework/CsvTrace.h"
+#include <modules/elements/buffers/BufferChannel.h>
 #include <stdint.h>
 #include <memory>
-#include <list>
 
-class BufferFiFoOutIf :  virtual public sc_interface {
+class BufferFiFoOutIf : public virtual BufferChannelOutIf<std::unique_ptr<uint8_t[]> > {
 public:
-    virtual void write(uint8_t*,int) = 0;          // blocking write
-    virtual bool nbwrite(uint8_t*,int) = 0;          // noblocking write
-
-protected:
-    BufferFiFoOutIf() {
-    };
-private:
-    BufferFiFoOutIf (const BufferFiFoOutIf&);      // disable copy
-    BufferFiFoOutIf& operator= (const BufferFiFoOutIf&); // disable
+    using BufferChannelOutIf<std::unique_ptr<uint8_t[]> >::write;
+    using BufferChannelOutIf<std::unique_ptr<uint8_t[]> >::nbwrite;
+    virtual void write(uint8_t* c, int size) = 0;    // blocking write, copies the element
+    virtual bool nbwrite(uint8_t* c, int size) = 0;  // noblocking write, copies the element
 };
 
-class BufferFiFoInIf :  virtual public sc_interface {
-public:
-    virtual void read(uint8_t*&,int&) = 0;          // blocking read
-    virtual uint8_t* read(int&) = 0;
-
-protected:
-    BufferFiFoInIf() {
-    };
-private:
-    BufferFiFoInIf(const BufferFiFoInIf&);            // disable copy
-    BufferFiFoInIf& operator= (const BufferFiFoInIf&); // disable =
-};
+typedef BufferChannelInIf<std::unique_ptr<uint8_t[]> > BufferFiFoInIf;
 
 class BufferFiFo
-    : public sc_core::sc_prim_channel
+    : public BufferChannel<std::unique_ptr<uint8_t[]>, CapacityElements, OrderRing, ReleaseOnRead>
     , public BufferFiFoOutIf
-    , public BufferFiFoInIf {
+{
 public:
     BufferFiFo(const char* name);
-    virtual ~BufferFiFo();
-
-    void reset();
 
+    void write(std::unique_ptr<uint8_t[]> element, int64_t key, int size);
+    bool nbwrite(std::unique_ptr<uint8_t[]>& element, int64_t key, int size);
     void write(uint8_t* c, int size);
     bool nbwrite(uint8_t* c, int size);
 
-    void read(uint8_t*& c, int& size);
-    uint8_t* read(int& size);
-
-    int fill;
-
 private:
-    void loadConfig();
-
-    int size;                 // size
-    std::list<std::pair<uint8_t*,int>> buf;              // buffer
-    bool readState;
-
-    sc_event dataReadEvent;
-    sc_event dataWriteEvent;
-
-    std::shared_ptr<CsvTrace> m_csvTrace;
-
+    typedef BufferChannel<std::unique_ptr<uint8_t[]>, CapacityElements, OrderRing, ReleaseOnRead> Channel;
 };
+
 #endif /* BUFFERFIFO_H_ */
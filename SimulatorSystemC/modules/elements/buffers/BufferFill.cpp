@@ -27,6 +27,9 @@
 
 #include <modules/elements/buffers/BufferFill.h>
 #include "framework/Configuration.h"
+#include "tlm_utils/tlm_quantumkeeper.h"
+#include <algorithm>
+#include <string>
 // constructor
 
 #define MODULE_ID_STR "/digisoft/simulator/modules/elements/buffers/BufferFill"
@@ -38,7 +41,8 @@ BufferFill::BufferFill(const char* my_name)
     : sc_prim_channel(my_name)
 {
     this->loadConfig();
-    buf = new uint8_t*[this->size];
+    buf.resize(this->banks * this->bankSize);
+    m_region = MemoryModel::getInstance().region(this->name());
     reset();
 }
 
@@ -68,6 +72,43 @@ void BufferFill::loadConfig()
     }
 
     this->size = s["size"].GetInt();
+    this->bankSize = this->size;
+
+    if (s.HasMember("mode")) {
+        std::string mode = s["mode"].IsString() ? s["mode"].GetString() : "";
+        if (mode == "pingPong") {
+            this->banks = 2;
+            this->bankSize = std::max(1, this->size / 2);
+        } else if (mode != "fill") {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"mode\" is no String \"fill\" or \"pingPong\"";
+            SC_REPORT_FATAL(MODULE_ID_STR , message.c_str());
+        }
+    }
+
+    if (s.HasMember("elementSize")) {
+        if (!s["elementSize"].IsInt() || s["elementSize"].GetInt() <= 0) {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"elementSize\" is no positive Int";
+            SC_REPORT_FATAL(MODULE_ID_STR , message.c_str());
+        }
+        this->m_elementSize = s["elementSize"].GetInt();
+    }
+
+    if (s.HasMember("flushTimeout")) {
+        if (!s["flushTimeout"].IsNumber() || s["flushTimeout"].GetDouble() <= 0) {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"flushTimeout\" is no positive Number";
+            SC_REPORT_FATAL(MODULE_ID_STR , message.c_str());
+        }
+        this->m_flushTimeout = sc_time(s["flushTimeout"].GetDouble(), SC_SEC);
+    }
 
     if (!s.HasMember("trace") || !s["trace"].IsBool()) {
         std::string message;
@@ -81,64 +122,146 @@ void BufferFill::loadConfig()
             m_csvTrace->delta_cycles(true);
             m_csvTrace->trace(this->fill, std::string(this->name()).append(".fill"), "fill in elements");
             m_csvTrace->trace(this->rd, std::string(this->name()).append(".rd"), "readPointer in elements");
+            m_csvTrace->trace(this->flushes, std::string(this->name()).append(".flushes"), "partial buffers flushed by timeout");
+            m_csvTrace->trace(this->handoverLatency, std::string(this->name()).append(".handoverLatency"), "seconds from the first element to the hand over");
         }
     }
 }
 
 BufferFill::~BufferFill()                   //destructor
 {
-    delete [] buf;
 }
 
 /** @brief write c to the buffer
  *
- * When reading is in progress will block, until buffer is Empty
+ * When reading is in progress will block, until buffer is Empty.
+ * In ping-pong mode only blocks, when the other half is still read.
  *
  * @param c pointer witch will be stored.
  *
  */
 void BufferFill::write(uint8_t* c)        // blocking write
 {
-    if (fill == size) {
-        wait(dataEmptyEvent);
+    sc_time delay = SC_ZERO_TIME;
+    write(c, delay);
+}
+
+/** @brief write c to the buffer, from a writer that is ahead of the simulation time (temporal decoupling).
+ *
+ * The buffer gets full at the local time of the writer, so the reader starts at the annotated time.
+ * If the buffer is already full, the writer is synchronized with the simulation time, before it blocks.
+ *
+ * @param c pointer witch will be stored.
+ * @param delay local time offset of the writer. Is set to zero, if the writer got synchronized.
+ *
+ */
+void BufferFill::write(uint8_t* c, sc_time& delay)
+{
+    if (m_ready[m_writeBank]) {
+        // the bank of the writer was handed over (full or flushed), continue with the next one.
+        // With one bank that is the same one, so wait till it is read.
+        int next = (m_writeBank + 1) % banks;
+        while (m_ready[next]) {
+            if (delay != SC_ZERO_TIME) {
+                wait(delay);
+                delay = SC_ZERO_TIME;
+            }
+            wait(dataEmptyEvent);
+        }
+        m_writeBank = next;
     }
 
-    buf[fill] = c;
-    fill++;
+    int& count = m_count[m_writeBank];
+    buf[m_writeBank * bankSize + count] = c;
+    count++;
+    fill = count;
+    updateRegion();
 
-    if (fill == size) {
-        dataFullEvent.notify(SC_ZERO_TIME);
+    if (count == 1) {
+        m_bankStart = sc_time_stamp() + delay;
+        dataStartEvent.notify(delay);
+    }
+    if (count == bankSize) {
+        handoverLatency = (sc_time_stamp() + delay - m_bankStart).to_seconds();
+        m_ready[m_writeBank] = true;
+        dataFullEvent.notify(delay);
     }
 
 }
 
+/** @brief hand the partially filled bank of the writer to the reader
+ */
+void BufferFill::handOver(int bank)
+{
+    handoverLatency = (sc_time_stamp() - m_bankStart).to_seconds();
+    m_ready[bank] = true;
+    flushes++;
+}
+
+/** @brief set the bytes of the elements, that are written and not read yet, in the memory model
+ */
+void BufferFill::updateRegion()
+{
+    int elements = -rd;
+    for (int i = 0; i < banks; i++) {
+        elements += m_count[i];
+    }
+    m_region->set((unsigned long)elements * m_elementSize);
+}
+
 /** @brief reset the buffer
  */
 void BufferFill::reset()
 {
     fill = 0;
     rd = 0;
-    readState = false;
+    m_count.assign(banks, 0);
+    m_ready.assign(banks, false);
+    m_writeBank = 0;
+    m_readBank = 0;
+    m_region->set(0);
 }
 
 /** @brief wait till buffer is full. Then allow read until buffer is empty again.
+ *
+ * With "flushTimeout", reading also starts when the first element waits longer than the timeout.
  *
  * @param c pointer to an stored element
  *
  */
 void BufferFill::read(uint8_t*& c)        // blocking read
 {
-    if (!(fill == size)) {
-        wait(dataFullEvent);
+    // a bank, that is not handed over, is always the one of the writer
+    while (!m_ready[m_readBank]) {
+        if (m_flushTimeout == SC_ZERO_TIME) {
+            wait(dataFullEvent);
+        } else if (m_count[m_readBank] == 0) {
+            wait(dataFullEvent | dataStartEvent);
+        } else if (sc_time_stamp() >= m_bankStart + m_flushTimeout) {
+            handOver(m_readBank);
+        } else {
+            wait(m_bankStart + m_flushTimeout - sc_time_stamp(), dataFullEvent);
+        }
     }
 
-    c = buf[rd];
+    int bank = m_readBank;
+    c = buf[bank * bankSize + rd];
     rd++;
-    //force delta cycle
-    wait(SC_ZERO_TIME);
+    updateRegion();
+    //force delta cycle. Not with temporal decoupling, there the whole buffer is read in one go.
+    //Not in ping-pong mode either, there the writer doesn't wait for the reader.
+    if (banks == 1 && tlm_utils::tlm_quantumkeeper::get_global_quantum() == SC_ZERO_TIME) {
+        wait(SC_ZERO_TIME);
+    }
 
-    if (rd == fill) {
-        reset();
+    if (rd == m_count[bank]) {
+        m_count[bank] = 0;
+        m_ready[bank] = false;
+        rd = 0;
+        if (bank == m_writeBank) {
+            fill = 0;
+        }
+        m_readBank = (bank + 1) % banks;
         dataEmptyEvent.notify(SC_ZERO_TIME);
     }
 }
@@ -154,5 +277,42 @@ uint8_t* BufferFill::read()                // shortcut read function
     read(c);
     return c;
 }
+
+/** @brief set the owner of the packets that are written to the buffer.
+ *
+ * @param owner gets the packets back in @release(). If NULL the packets are deleted.
+ */
+void BufferFill::setPacketOwner(BufferFillPacketOwnerIf* owner)
+{
+    m_packetOwner = owner;
+}
+
+/** @brief set the layout of the packets, that are written to the buffer.
+ *
+ * The writer sets it before the simulation starts, so the reader knows it from the beginning.
+ */
+void BufferFill::setPacketFormat(TsPacketFormat format)
+{
+    m_packetFormat = format;
+}
+
+/** @brief get the layout of the packets in the buffer.
+ */
+TsPacketFormat BufferFill::packetFormat()
+{
+    return m_packetFormat;
+}
+
+/** @brief called by the reader, when it doesn't need a read packet any more.
+ *
+ */
+void BufferFill::release(uint8_t* c)
+{
+    if (m_packetOwner) {
+        m_packetOwner->release(c);
+    } else {
+        delete[] c;
+    }
+}
 #undef MODULE_ID_STR
 
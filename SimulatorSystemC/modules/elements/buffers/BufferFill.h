@@ -22,6 +22,17 @@
  * THE SOFTWARE.
  *
  * @file Buffer to simulate a Buffer, that just empties after it is fully filled.
+ *
+ * With "mode": "pingPong" the buffer is split into two halves, like a double buffered DMA: the writer fills
+ * one half while the reader drains the other one. With "flushTimeout" (in seconds) a partially filled
+ * half is handed to the reader, when its first packet is older than the timeout, like the interrupt timer
+ * of a DMA engine. Both can be combined, the default is one buffer without timeout.
+ *
+ * For the memory model (see MemoryModel.h) every element counts "elementSize" bytes, 188 by default.
+ *
+ * A writer running ahead of the simulation time (see DecoupledWriter.h) annotates every element with its local
+ * time, but the buffer only keeps the time it got full. The reader gets all elements of the buffer at that time,
+ * so the times of the single elements are lost, and with a "size" of 1 the quantum saves nothing.
  */
 
 
@@ -30,12 +41,31 @@
 
 #include "systemc.h"
 #include "framework/CsvTrace.h"
+#include "framework/MemoryModel.h"
+#include <modules/elements/input/TsPacketFormat.h>
 #include <stdint.h>
 #include <memory>
+#include <vector>
+
+/** @brief implemented by the owner of the packets written to a BufferFill.
+ *
+ * If a writer does not allocate its packets with new[] (e.g. they are views into a mapped file, or come
+ * out of a PacketPool), it registers itself as owner, and gets the packets back when the reading side is
+ * done with them.
+ */
+class BufferFillPacketOwnerIf {
+public:
+    virtual void release(uint8_t*) = 0;
+    virtual ~BufferFillPacketOwnerIf() {
+    };
+};
 
 class BufferFillOutIf :  virtual public sc_interface {
 public:
     virtual void write(uint8_t*) = 0;          // blocking write
+    virtual void write(uint8_t*, sc_time&) = 0; // blocking write of a writer running ahead of the simulation time
+    virtual void setPacketOwner(BufferFillPacketOwnerIf*) = 0; // NULL means the packets are deleted with delete[]
+    virtual void setPacketFormat(TsPacketFormat) = 0;          // layout of the written packets, "ts" by default
 protected:
     BufferFillOutIf() {
     };
@@ -48,6 +78,8 @@ class BufferFillInIf :  virtual public sc_interface {
 public:
     virtual void read(uint8_t*&) = 0;          // blocking read
     virtual uint8_t* read() = 0;
+    virtual void release(uint8_t*) = 0;        // give a read packet back to its owner
+    virtual TsPacketFormat packetFormat() = 0; // layout of the packets, as set by the writer
 
 protected:
     BufferFillInIf () {
@@ -68,21 +100,43 @@ public:
     void reset();
 
     void write(uint8_t* c);
+    void write(uint8_t* c, sc_time& delay);
+    void setPacketOwner(BufferFillPacketOwnerIf* owner);
+    void setPacketFormat(TsPacketFormat format);
     void read(uint8_t*& c);
     uint8_t* read();
+    void release(uint8_t* c);
+    TsPacketFormat packetFormat();
 
     int fill = 0;
     int rd = 0;
+    int flushes = 0;
+    double handoverLatency = 0;
 
 private:
     void loadConfig();
+    void handOver(int bank);
+    void updateRegion();
 
     int size;                 // size
-    uint8_t** buf;              // buffer
-    bool readState;
+    int banks = 1;            // 2 in ping-pong mode
+    int bankSize;             // elements per bank
+    std::vector<uint8_t*> buf;  // buffer, banks * bankSize elements
+    std::vector<int> m_count;   // elements written to each bank
+    std::vector<bool> m_ready;  // bank is handed to the reader
+    int m_writeBank = 0;
+    int m_readBank = 0;
+    sc_time m_flushTimeout = SC_ZERO_TIME; // SC_ZERO_TIME means no timeout
+    sc_time m_bankStart;        // time of the first element in the bank of the writer
+    BufferFillPacketOwnerIf* m_packetOwner = NULL;
+    TsPacketFormat m_packetFormat = TS_PACKET_FORMAT_TS;
 
     sc_event dataFullEvent;
     sc_event dataEmptyEvent;
+    sc_event dataStartEvent;
+
+    int m_elementSize = 188;    // bytes of an element in the memory model
+    std::shared_ptr<MemoryRegion> m_region;
 
     std::shared_ptr<CsvTrace> m_csvTrace;
 
@@ -26,6 +26,7 @@
 
 #include <modules/elements/buffers/BufferPicture.h>
 #include "framework/Configuration.h"
+#include <iterator>
 
 
 #define MODULE_ID_STR "/digisoft/simulator/modules/elements/buffers/BufferPicture"
@@ -36,6 +37,7 @@ BufferPicture::BufferPicture(const char* name)
     : sc_prim_channel(name)
 {
     this->loadConfig();
+    m_region = MemoryModel::getInstance().region(this->name());
     this->reset();
 }
 
@@ -66,6 +68,40 @@ void BufferPicture::loadConfig()
 
     this->m_size = s["size"].GetInt();
 
+    m_watermarks.loadConfig(s, this->name(), MODULE_ID_STR, this->m_size);
+
+    if (s.HasMember("width") || s.HasMember("height")) {
+        if (!s.HasMember("width") || !s["width"].IsInt() || s["width"].GetInt() <= 0
+                || !s.HasMember("height") || !s["height"].IsInt() || s["height"].GetInt() <= 0) {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"width\" and \"height\" have to be given both, as positive Int";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+        std::string pixelFormat = "yuv420";
+        if (s.HasMember("pixelFormat")) {
+            pixelFormat = s["pixelFormat"].IsString() ? s["pixelFormat"].GetString() : "";
+        }
+        int bitsPerPixel = 0;
+        if (pixelFormat == "yuv420") {
+            bitsPerPixel = 12;
+        } else if (pixelFormat == "yuv422") {
+            bitsPerPixel = 16;
+        } else if (pixelFormat == "rgb24") {
+            bitsPerPixel = 24;
+        } else if (pixelFormat == "argb32") {
+            bitsPerPixel = 32;
+        } else {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"pixelFormat\" is no String \"yuv420\", \"yuv422\", \"rgb24\" or \"argb32\"";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+        m_frameBytes = (unsigned long)s["width"].GetInt() * s["height"].GetInt() * bitsPerPixel / 8;
+    }
+
     if (!s.HasMember("trace") || !s["trace"].IsBool()) {
         std::string message;
         message += "Malformed configuration of \"";
@@ -81,19 +117,10 @@ void BufferPicture::loadConfig()
     }
 }
 
-/** @brief delete all remaining elements in the map
+/** @brief the remaining elements are freed with the map
  *
  */
 BufferPicture::~BufferPicture() {
-
-    for (std::map<int64_t, std::tuple<uint8_t*, int, int> >::iterator it=buf.begin(); it!=buf.end(); ++it)
-    {
-        std::tuple<uint8_t*,int,int> elem = it->second;
-        delete [] std::get<0>(elem);
-        buf.erase(it);
-        --fill;
-    }
-
 }
 
 /** @brief reset the buffer
@@ -102,6 +129,16 @@ BufferPicture::~BufferPicture() {
 void BufferPicture::reset()
 {
     fill = 0;
+    m_bytes = 0;
+    updateRegion();
+}
+
+/** @brief set the bytes of the frames in the memory model
+ *
+ */
+void BufferPicture::updateRegion()
+{
+    m_region->set(m_frameBytes ? fill * m_frameBytes : m_bytes);
 }
 
 /** @brief save an element in the buffer
@@ -116,10 +153,12 @@ void BufferPicture::reset()
  *
  * @return key to identify the element, to use with @finished()
  */
-int64_t BufferPicture::write(uint8_t* c, int64_t pts, int size)
+int64_t BufferPicture::write(std::shared_ptr<uint8_t> c, int64_t pts, int size)
 {
     if (fill == this->m_size) {
+        m_watermarks.writerBlocked(true);
         wait(bufferElementDeleteEvent);
+        m_watermarks.writerBlocked(false);
     }
 
     while (buf.count(pts)>0)
@@ -135,6 +174,9 @@ int64_t BufferPicture::write(uint8_t* c, int64_t pts, int size)
 
 
     ++fill;
+    m_watermarks.update(fill - 1, fill);
+    m_bytes += size;
+    updateRegion();
     bufferElementWriteEvent.notify();
 
     return pts;
@@ -148,11 +190,25 @@ int64_t BufferPicture::write(uint8_t* c, int64_t pts, int size)
  * @param frames list of by write given keys
  *
  */
-void BufferPicture::finished(std::list<int64_t> frames)
+void BufferPicture::finished(const std::list<int64_t>& frames)
+{
+    for (std::list<int64_t>::const_iterator frame=frames.begin(); frame != frames.end(); ++frame)
+    {
+        this->finished(*frame);
+    }
+}
+
+/** @brief call this function when an element is no longer needed by the former element, see above.
+ *
+ * @param key by write given key
+ *
+ */
+void BufferPicture::finished(int64_t key)
 {
-    for (std::list<int64_t>::iterator frame=frames.begin(); frame != frames.end(); ++frame)
+    FrameMap::iterator frame = buf.find(key);
+    if (frame != buf.end())
     {
-        this->finish(*frame);
+        this->finish(frame);
     }
 }
 
@@ -160,90 +216,51 @@ void BufferPicture::finished(std::list<int64_t> frames)
  *
  * This funciton will read and remove the element with a pts nearest to pt
  * from the buffer, and delete all elements with a timestamp lower than this.
+ * The frames are ordered by pts, so both are found with a lookup in the map instead of a walk over all frames.
  *
- * @param[out] c buffer to fill with the element, null if none present
+ * @param[out] c the element, shared with the buffer (no copy). null if none present
  * @param[in] requested timestamp
  * @param[out] size of c, 0 if there is nothing to retrun
  */
-void BufferPicture::nbread(uint8_t*& c, int64_t pt, int& size)
+void BufferPicture::nbread(std::shared_ptr<uint8_t>& c, int64_t pt, int& size)
 {
-    std::list<int64_t> toFinish;
-
     if(lastRequest>pt){
         SC_REPORT_WARNING(MODULE_ID_STR,"this request time is before the last request.\n"
                 "Likely its an stc jump or warparound. If not there is something wrong.\n"
                 "Will throw away all pictures after the last pts request");
 
-        for (std::map<int64_t, std::tuple<uint8_t*, int, int> >::iterator it=buf.begin(); it!=buf.end(); ++it)
+        for (FrameMap::iterator it = buf.upper_bound(lastRequest); it != buf.end(); )
         {
-            int64_t pts = it->first;
-            if (pts > lastRequest)
-            {
-                toFinish.push_back(it->first);
-            }
+            it = this->finish(it);
         }
-
     }
 
-    if(fill == 0)
-    {
-        c = NULL;
-        size = 0;
-    }
-    else
-    {
-        int64_t resultTime = 0;
-        std::map<int64_t, std::tuple<uint8_t*, int, int> >::iterator result = buf.end();
-        for (std::map<int64_t, std::tuple<uint8_t*, int, int> >::iterator it=buf.begin(); it!=buf.end(); ++it)
-        {
-            int64_t pts = it->first;
-            /*
-             * pts>(pt-STC_WARPAROUND_OFFSET) don't care about elements that are too early
-             */
-            if (pts < pt && pts > (pt - STC_WARPAROUND_OFFSET))
-            {
-                // get the packet nearest to the pt
-                if(resultTime < pts){
-                    resultTime = pts;
-                    toFinish.push_back(result->first);
-                    result = it;
-                }
-                else
-                {
-                    toFinish.push_back(it->first);
-                }
-            }
-        }
+    /*
+     * pts>(pt-STC_WARPAROUND_OFFSET) don't care about elements that are too early
+     * the frame to show is the last one before pt, all frames in front of it are too late
+     */
+    FrameMap::iterator first = buf.upper_bound(pt - STC_WARPAROUND_OFFSET);
+    FrameMap::iterator end = buf.lower_bound(pt);
 
-        if (result != buf.end())
-        {
-            std::tuple<uint8_t*, int, int> elem = result->second;
-            size = std::get<1>(elem);
-            c = new uint8_t[size];
-            memcpy(c, std::get<0>(elem), size);
-            toFinish.push_back(result->first);
-        }
-        else
+    if (first != end)
+    {
+        FrameMap::iterator result = std::prev(end);
+        while (first != result)
         {
-            size = 0;
-            c = NULL;
+            first = this->finish(first);
         }
 
+        c = std::get<0>(result->second);
+        size = std::get<1>(result->second);
+        this->finish(result);
     }
-
-    this->finished(toFinish);
-    lastRequest = pt;
-}
-
-/** @brief interface for iterators to @finish()
- *
- */
-void BufferPicture::finish(std::list<int64_t> toFinish)
-{
-    for(std::list<int64_t>::iterator it = toFinish.begin(); it != toFinish.end(); ++it)
+    else
     {
-        finish(*it);
+        size = 0;
+        c = NULL;
     }
+
+    lastRequest = pt;
 }
 
 /** @brief function to call to delete an element
@@ -252,33 +269,56 @@ void BufferPicture::finish(std::list<int64_t> toFinish)
  * there is no need anymore for this element. The decoder has finished its work, and
  * the picture as already been removed from the buffer
  *
- * @param key for the element to remove. it is basically the pts of the vaule in the map.
+ * @param frame the element to remove
  *
+ * @return the element behind frame
  */
-void BufferPicture::finish(int64_t key)
+BufferPicture::FrameMap::iterator BufferPicture::finish(FrameMap::iterator frame)
 {
-
-    std::tuple<uint8_t*, int, int> savedFrame = buf[key];
-
     /*
      * reduce counter
      */
-    --std::get<2>(savedFrame);
+    --std::get<2>(frame->second);
 
     /*
-     * if counter at 0 delete
+     * if counter at 0 delete, the frame is freed with its last reference
      */
-    if (std::get<2>(savedFrame) == 0)
+    if (std::get<2>(frame->second) == 0)
     {
-        delete [] std::get<0>(savedFrame);
-        this->buf.erase(key);
         --this->fill;
+        m_watermarks.update(this->fill + 1, this->fill);
+        m_bytes -= std::get<1>(frame->second);
+        updateRegion();
         bufferElementDeleteEvent.notify();
+        return this->buf.erase(frame);
     }
-    else
-    {
-        this->buf[key] = savedFrame;
-    }
+    return ++frame;
+}
+
+/** @brief block till fill is at or above "highWatermark"
+ *
+ */
+void BufferPicture::waitHighWatermark()
+{
+    m_watermarks.waitHigh(this->fill);
+}
+
+/** @brief block till fill is at or below "lowWatermark"
+ *
+ */
+void BufferPicture::waitLowWatermark()
+{
+    m_watermarks.waitLow(this->fill);
+}
+
+const sc_event& BufferPicture::highWatermarkEvent() const
+{
+    return m_watermarks.highEvent();
+}
+
+const sc_event& BufferPicture::lowWatermarkEvent() const
+{
+    return m_watermarks.lowEvent();
 }
 
 #undef MODULE_ID_STR
@@ -22,6 +22,12 @@
  * THE SOFTWARE.
  *
  * @file Buffer to simulate a picture Buffer behavior.
+ *
+ * "highWatermark" and "lowWatermark" in pictures are optional, see Watermarks.h.
+ *
+ * In the memory model (see MemoryModel.h) a frame counts its decoded size: "width" * "height" in the
+ * "pixelFormat" "yuv420" (default), "yuv422", "rgb24" or "argb32". Without "width" and "height" (e.g. audio)
+ * the size given to write() is counted.
  */
 
 #ifndef BUFFERDECODE_H_
@@ -29,6 +35,8 @@
 
 #include "systemc.h"
 #include "framework/CsvTrace.h"
+#include <modules/elements/buffers/Watermarks.h>
+#include "framework/MemoryModel.h"
 #include <stdint.h>
 #include <memory>
 #include <map>
@@ -39,8 +47,11 @@
 
 class BufferPictureOutIf :  virtual public sc_interface {
 public:
-    virtual int64_t write(uint8_t*, int64_t pts, int size) = 0;          // blocking write
-    virtual void finished(std::list<int64_t> keys) = 0;          // no need on the writing side for thease frames
+    virtual int64_t write(std::shared_ptr<uint8_t>, int64_t pts, int size) = 0;          // blocking write
+    virtual void finished(const std::list<int64_t>& keys) = 0;          // no need on the writing side for thease frames
+    virtual void finished(int64_t key) = 0;                             // no need on the writing side for this frame
+    virtual void waitLowWatermark() = 0;                                // block till fill is at or below the low watermark
+    virtual const sc_event& lowWatermarkEvent() const = 0;
 protected:
     BufferPictureOutIf() {
     };
@@ -51,7 +62,9 @@ private:
 
 class BufferPictureInIf :  virtual public sc_interface {
 public:
-    virtual void nbread(uint8_t*&, int64_t pt, int& size) = 0;          // noblocking read
+    virtual void nbread(std::shared_ptr<uint8_t>&, int64_t pt, int& size) = 0;          // noblocking read, hands out the frame without copy
+    virtual void waitHighWatermark() = 0;                                               // block till fill is at or above the high watermark
+    virtual const sc_event& highWatermarkEvent() const = 0;
 
 protected:
     BufferPictureInIf () {
@@ -73,31 +86,40 @@ public:
 
     void reset();
 
-    int64_t write(uint8_t* c, int64_t pts, int size);
-    void finished(std::list<int64_t> keys);
+    int64_t write(std::shared_ptr<uint8_t> c, int64_t pts, int size);
+    void finished(const std::list<int64_t>& keys);
+    void finished(int64_t key);
 
-    void nbread(uint8_t*& c, int64_t pt, int& size);
+    void nbread(std::shared_ptr<uint8_t>& c, int64_t pt, int& size);
+
+    void waitHighWatermark();
+    void waitLowWatermark();
+    const sc_event& highWatermarkEvent() const;
+    const sc_event& lowWatermarkEvent() const;
 
     int fill;
     int64_t lastRequest = 0;
 
 private:
+    typedef std::map<int64_t, std::tuple<std::shared_ptr<uint8_t>, int, int> > FrameMap;
+
     void loadConfig();
 
-    void finish(int64_t key);
-    /*
-     * interfaces to finish:
-     */
-    void finish(std::list<int64_t> it);
+    FrameMap::iterator finish(FrameMap::iterator frame);
+    void updateRegion();
 
 
     int m_size;                 // size
 
-    std::map<int64_t, std::tuple<uint8_t*, int, int> > buf;/*!< this map holds each frame an the information in the order <pts,<frame,size,reference counter>> */
+    FrameMap buf;/*!< this map holds each frame an the information in the order <pts,<frame,size,reference counter>> */
     bool readState;
 
     sc_event bufferElementDeleteEvent;
     sc_event bufferElementWriteEvent;
+    Watermarks m_watermarks;
+    unsigned long m_frameBytes = 0; // decoded size of a frame, 0 to count the written sizes
+    unsigned long m_bytes = 0;      // written sizes of the stored frames
+    std::shared_ptr<MemoryRegion> m_region;
 
     std::shared_ptr<CsvTrace> m_csvTrace;
 
@@ -0,0 +1,159 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file contiguous byte ring with a descriptor ring, like the bitstream buffer of a hardware decoder.
+ *
+ * Every element is stored in one piece. If it doesn't fit in front of the end of the ring, the bytes up to
+ * the end stay unused and the element is stored at the start (wrap around fragmentation). A compact
+ * descriptor per element keeps offset, size and pts. Elements are read in order, and the space is given
+ * back with release(), in any order: the oldest end of the ring only moves over released elements.
+ */
+
+#ifndef BUFFERS_BYTERING_H_
+#define BUFFERS_BYTERING_H_
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+class ByteRing {
+public:
+    /** @param size size of the ring in bytes */
+    explicit ByteRing(size_t size):
+        m_bytes(size),
+        m_descriptors(16),
+        m_mask(15)
+    {
+    };
+
+    size_t size() const {
+        return m_bytes.size();
+    }
+
+    /** @brief bytes taken by the elements not released yet, including the unused bytes in front of wrapped elements */
+    size_t used() const {
+        return m_used;
+    }
+
+    /** @brief space for an element, at the end of the ring.
+     *
+     * @param[in] size size of the element
+     * @param[in] pts pts of the element
+     *
+     * @return where to write the element, NULL if there is not enough contiguous space at the moment,
+     *         or size is 0
+     */
+    uint8_t* push(size_t size, int64_t pts) {
+        if (m_used == 0) {
+            // empty, so start at the beginning without a gap
+            m_head = 0;
+        }
+
+        size_t offset = m_head;
+        size_t gap = 0;
+        if (m_head + size > m_bytes.size()) {
+            gap = m_bytes.size() - m_head;
+            offset = 0;
+        }
+        if (size == 0 || m_used + gap + size > m_bytes.size()) {
+            return NULL;
+        }
+
+        if (m_end - m_first == m_descriptors.size()) {
+            grow();
+        }
+        Descriptor& descriptor = m_descriptors[m_end & m_mask];
+        descriptor.pts = pts;
+        descriptor.offset = offset;
+        descriptor.size = size;
+        descriptor.span = gap + size;
+        descriptor.released = false;
+        m_end++;
+
+        m_head = (offset + size) % m_bytes.size();
+        m_used += gap + size;
+        return m_bytes.data() + offset;
+    }
+
+    /** @brief read the oldest element not read yet. It stays in the ring till it is released.
+     *
+     * @param[out] id to give to release()
+     * @param[out] data the element, in the ring
+     * @param[out] size size of the element
+     * @param[out] pts pts of the element
+     *
+     * @return false if all elements are read
+     */
+    bool pop(uint64_t& id, uint8_t*& data, int& size, int64_t& pts) {
+        if (m_read == m_end) {
+            return false;
+        }
+        const Descriptor& descriptor = m_descriptors[m_read & m_mask];
+        id = m_read;
+        data = m_bytes.data() + descriptor.offset;
+        size = descriptor.size;
+        pts = descriptor.pts;
+        m_read++;
+        return true;
+    }
+
+    /** @brief give the space of a read element back */
+    void release(uint64_t id) {
+        m_descriptors[id & m_mask].released = true;
+        while (m_first < m_read && m_descriptors[m_first & m_mask].released) {
+            m_used -= m_descriptors[m_first & m_mask].span;
+            m_first++;
+        }
+    }
+
+private:
+    struct Descriptor {
+        int64_t pts;
+        uint32_t offset;
+        uint32_t size;
+        uint32_t span;      /** size and the unused bytes in front of it */
+        bool released;
+    };
+
+    /** @brief double the descriptor ring, the ids stay the same */
+    void grow() {
+        std::vector<Descriptor> descriptors(m_descriptors.size() * 2);
+        size_t mask = descriptors.size() - 1;
+        for (uint64_t i = m_first; i < m_end; i++) {
+            descriptors[i & mask] = m_descriptors[i & m_mask];
+        }
+        m_descriptors.swap(descriptors);
+        m_mask = mask;
+    }
+
+    std::vector<uint8_t> m_bytes;
+    std::vector<Descriptor> m_descriptors;
+    size_t m_mask;
+    size_t m_head = 0;      /** where the next element goes */
+    size_t m_used = 0;
+    uint64_t m_first = 0;   /** oldest element not released */
+    uint64_t m_read = 0;    /** oldest element not read */
+    uint64_t m_end = 0;     /** behind the newest element */
+};
+
+#endif /* BUFFERS_BYTERING_H_ */
@@ -0,0 +1,150 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file pool of fixed size packets, handed through a BufferFill and given back to the pool on release.
+ *
+ * The packets are cut out of slabs, that are allocated once and only freed with the pool. A released
+ * packet goes on an intrusive free list (the link is stored in the packet itself), so get() and release()
+ * are a pointer swap. Every packet starts on a cache line, so two packets never share one.
+ *
+ * The pool is not thread safe, get() and release() are called from SystemC processes only.
+ * The slabs are charged to the AllocationAccount set with setAccount().
+ */
+
+#ifndef BUFFERS_PACKETPOOL_H_
+#define BUFFERS_PACKETPOOL_H_
+
+#include <modules/elements/buffers/BufferFill.h>
+#include "framework/AllocationTracker.h"
+#include <algorithm>
+#include <new>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define PACKET_POOL_ALIGN 64          /** cache line size */
+#define PACKET_POOL_SLAB_PACKETS 1024 /** packets allocated at once */
+
+class PacketPool : public BufferFillPacketOwnerIf {
+public:
+    /** @param packetSize size of one packet in bytes
+     * @param slabPackets amount of packets in one slab
+     */
+    explicit PacketPool(size_t packetSize = 188, size_t slabPackets = PACKET_POOL_SLAB_PACKETS):
+        m_packetSize(packetSize),
+        m_stride((std::max(packetSize, sizeof(FreePacket)) + PACKET_POOL_ALIGN - 1) / PACKET_POOL_ALIGN * PACKET_POOL_ALIGN),
+        m_slabPackets(slabPackets)
+    {
+    };
+
+    ~PacketPool() {
+        if (m_account) {
+            m_account->free(bytes());
+        }
+        for (size_t i = 0; i < m_slabs.size(); i++) {
+            free(m_slabs[i]);
+        }
+    }
+
+    /** @brief charge the slabs to account, the ones allocated already and all later ones */
+    void setAccount(const std::shared_ptr<AllocationAccount>& account) {
+        m_account = account;
+        m_account->allocate(bytes());
+    }
+
+    /** @brief get a packet of packetSize() bytes, the content is undefined */
+    uint8_t* get() {
+        if (!m_free) {
+            grow();
+        }
+        FreePacket* packet = m_free;
+        m_free = packet->next;
+        m_used++;
+        return (uint8_t*)packet;
+    }
+
+    /** @brief give a packet from get() back */
+    void release(uint8_t* packet) {
+        FreePacket* free = (FreePacket*)packet;
+        free->next = m_free;
+        m_free = free;
+        m_used--;
+    }
+
+    size_t packetSize() const {
+        return m_packetSize;
+    }
+
+    /** @brief packets handed out and not released yet */
+    size_t used() const {
+        return m_used;
+    }
+
+    /** @brief packets allocated, used or free */
+    size_t capacity() const {
+        return m_slabs.size() * m_slabPackets;
+    }
+
+    /** @brief bytes allocated for the slabs */
+    size_t bytes() const {
+        return capacity() * m_stride;
+    }
+
+private:
+    PacketPool(const PacketPool&);            // disable copy
+    PacketPool& operator=(const PacketPool&); // disable
+
+    struct FreePacket {
+        FreePacket* next;
+    };
+
+    /** @brief allocate one slab, and put its packets on the free list, the first one on top */
+    void grow() {
+        void* slab;
+        if (posix_memalign(&slab, PACKET_POOL_ALIGN, m_stride * m_slabPackets) != 0) {
+            throw std::bad_alloc();
+        }
+        m_slabs.push_back(slab);
+        if (m_account) {
+            m_account->allocate(m_stride * m_slabPackets);
+        }
+
+        for (size_t i = m_slabPackets; i > 0; i--) {
+            FreePacket* packet = (FreePacket*)((uint8_t*)slab + (i - 1) * m_stride);
+            packet->next = m_free;
+            m_free = packet;
+        }
+    }
+
+    size_t m_packetSize;
+    size_t m_stride;              /** distance between two packets in a slab */
+    size_t m_slabPackets;
+    std::vector<void*> m_slabs;
+    FreePacket* m_free = NULL;
+    size_t m_used = 0;
+    std::shared_ptr<AllocationAccount> m_account;
+};
+
+#undef PACKET_POOL_ALIGN
+#undef PACKET_POOL_SLAB_PACKETS
+#endif /* BUFFERS_PACKETPOOL_H_ */
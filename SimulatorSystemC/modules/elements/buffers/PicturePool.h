@@ -0,0 +1,159 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file pool of picture buffers in size classes, handed out as shared_ptr.
+ *
+ * A picture gets the smallest size class it fits in. The classes are the powers of two from 1 KB on,
+ * with three more steps in between each (so a buffer is at most 25% larger than asked for). When the last
+ * reference to a picture is dropped (e.g. by BufferPicture::finish), its buffer goes back to the free
+ * list of its class, instead of being freed, and is used for the next picture of that class.
+ *
+ * The free lists are shared with the handed out pictures, so pictures may outlive the pool.
+ * The pool is not thread safe, it is used from SystemC processes only.
+ * The buffers are charged to the AllocationAccount set with setAccount().
+ */
+
+#ifndef BUFFERS_PICTUREPOOL_H_
+#define BUFFERS_PICTUREPOOL_H_
+
+#include "framework/AllocationTracker.h"
+#include <memory>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PICTURE_POOL_MIN_SHIFT 10 /** smallest class is 1 KB */
+#define PICTURE_POOL_STEPS 4      /** classes per power of two */
+
+class PicturePool {
+public:
+    PicturePool():
+        m_lists(std::make_shared<FreeLists>())
+    {
+    };
+
+    /** @brief get a buffer of at least size bytes, the content is undefined.
+     *
+     * @return the buffer, given back to the pool with its last reference
+     */
+    std::shared_ptr<uint8_t> get(size_t size) {
+        size_t index = sizeClass(size);
+        if (m_lists->free.size() <= index) {
+            m_lists->free.resize(index + 1);
+        }
+
+        uint8_t* buffer;
+        std::vector<uint8_t*>& free = m_lists->free[index];
+        if (free.empty()) {
+            buffer = new uint8_t[classSize(index)];
+            m_lists->bytes += classSize(index);
+            if (m_lists->account) {
+                m_lists->account->allocate(classSize(index));
+            }
+        } else {
+            buffer = free.back();
+            free.pop_back();
+        }
+        m_lists->used += classSize(index);
+        return std::shared_ptr<uint8_t>(buffer, Release(m_lists, index));
+    }
+
+    /** @brief charge the buffers to account, the ones allocated already and all later ones */
+    void setAccount(const std::shared_ptr<AllocationAccount>& account) {
+        m_lists->account = account;
+        account->allocate(m_lists->bytes);
+    }
+
+    /** @brief bytes allocated, used or free */
+    size_t bytes() const {
+        return m_lists->bytes;
+    }
+
+    /** @brief bytes of the pictures alive */
+    size_t used() const {
+        return m_lists->used;
+    }
+
+    /** @brief size of the buffers of a class */
+    static size_t classSize(size_t index) {
+        if (index == 0) {
+            return (size_t)1 << PICTURE_POOL_MIN_SHIFT;
+        }
+        size_t shift = PICTURE_POOL_MIN_SHIFT + (index - 1) / PICTURE_POOL_STEPS;
+        size_t step = (index - 1) % PICTURE_POOL_STEPS + 1;
+        return ((size_t)1 << shift) + step * (((size_t)1 << shift) / PICTURE_POOL_STEPS);
+    }
+
+    /** @brief the smallest class, size fits in */
+    static size_t sizeClass(size_t size) {
+        if (size <= ((size_t)1 << PICTURE_POOL_MIN_SHIFT)) {
+            return 0;
+        }
+        size_t shift = PICTURE_POOL_MIN_SHIFT;
+        while (((size_t)2 << shift) < size) {
+            shift++;
+        }
+        // (1 << shift) < size <= (2 << shift)
+        size_t stepSize = ((size_t)1 << shift) / PICTURE_POOL_STEPS;
+        size_t step = (size - ((size_t)1 << shift) + stepSize - 1) / stepSize;
+        return (shift - PICTURE_POOL_MIN_SHIFT) * PICTURE_POOL_STEPS + step;
+    }
+
+private:
+    struct FreeLists {
+        ~FreeLists() {
+            if (account) {
+                account->free(bytes);
+            }
+            for (size_t i = 0; i < free.size(); i++) {
+                for (size_t j = 0; j < free[i].size(); j++) {
+                    delete[] free[i][j];
+                }
+            }
+        }
+        std::vector<std::vector<uint8_t*> > free; /** free buffers, per class */
+        size_t bytes = 0;
+        size_t used = 0;
+        std::shared_ptr<AllocationAccount> account;
+    };
+
+    /** @brief deleter of the handed out pictures */
+    struct Release {
+        Release(const std::shared_ptr<FreeLists>& lists, size_t index):
+            lists(lists), index(index)
+        {
+        };
+        void operator()(uint8_t* buffer) {
+            lists->free[index].push_back(buffer);
+            lists->used -= classSize(index);
+        }
+        std::shared_ptr<FreeLists> lists;
+        size_t index;
+    };
+
+    std::shared_ptr<FreeLists> m_lists;
+};
+
+#undef PICTURE_POOL_MIN_SHIFT
+#undef PICTURE_POOL_STEPS
+#endif /* BUFFERS_PICTUREPOOL_H_ */
@@ -0,0 +1,273 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file a RAM pool, that several buffers allocate their elements from, under one budget.
+ */
+
+#include <modules/elements/buffers/SharedMemoryPool.h>
+#include "framework/Configuration.h"
+#include <algorithm>
+
+#define MODULE_ID_STR "/digisoft/simulator/modules/elements/buffers/SharedMemoryPool"
+
+SharedMemoryPool::SharedMemoryPool(const char* name)
+    : sc_prim_channel(name)
+{
+    this->loadConfig();
+    pools().push_back(this);
+}
+
+/** @brief load the configuration
+ *
+ */
+void SharedMemoryPool::loadConfig()
+{
+    Configuration& config = Configuration::getInstance();
+
+    if (!config.HasMember(this->name())) {
+        std::string message;
+        message += "No Configuration found for: \"";
+        message += this->name();
+        message += "\"";
+        SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+    }
+
+    rapidjson::Value& s = config[this->name()];
+
+    if (!s.HasMember("size") || !s["size"].IsInt()) {
+        std::string message;
+        message += "Malformed configuration of \"";
+        message += this->name();
+        message += "\". \"size\" is missing or no Int";
+        SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+    }
+
+    this->m_size = s["size"].GetInt();
+
+    if (s.HasMember("policy")) {
+        m_policyName = s["policy"].IsString() ? s["policy"].GetString() : "";
+        if (m_policyName == "static") {
+            m_policy = POLICY_STATIC;
+        } else if (m_policyName == "firstCome") {
+            m_policy = POLICY_FIRST_COME;
+        } else if (m_policyName == "guaranteed") {
+            m_policy = POLICY_GUARANTEED;
+        } else {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += this->name();
+            message += "\". \"policy\" is no String \"static\", \"firstCome\" or \"guaranteed\"";
+            SC_REPORT_FATAL(MODULE_ID_STR, message.c_str());
+        }
+    }
+
+    if (!s.HasMember("trace") || !s["trace"].IsBool()) {
+        std::string message;
+        message += "Malformed configuration of \"";
+        message += this->name();
+        message += "\". \"trace\" is missing or no Bool. This Module will not been logged";
+        SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+    } else {
+        if (s["trace"].GetBool()) {
+            m_traceOn = true;
+            m_csvTrace = std::make_shared<CsvTrace>(config.dir());
+            m_csvTrace->delta_cycles(true);
+            m_csvTrace->trace(this->used, std::string(this->name()).append(".used"), "used in Bytes");
+            m_csvTrace->trace(this->underruns, std::string(this->name()).append(".underruns"), "underruns of all buffers");
+            m_csvTrace->trace(this->blocked, std::string(this->name()).append(".blocked"), "writes blocked by the pool");
+        }
+    }
+}
+
+SharedMemoryPool::~SharedMemoryPool()
+{
+    std::vector<SharedMemoryPool*>& all = pools();
+    all.erase(std::remove(all.begin(), all.end(), this), all.end());
+}
+
+/** @brief all pools there are, for reportAll()
+ *
+ */
+std::vector<SharedMemoryPool*>& SharedMemoryPool::pools()
+{
+    static std::vector<SharedMemoryPool*> pools;
+    return pools;
+}
+
+/** @brief the shares have to fit in the pool, but for "firstCome"
+ *
+ */
+void SharedMemoryPool::end_of_elaboration()
+{
+    if (m_policy != POLICY_FIRST_COME && m_shares > m_size) {
+        std::string message;
+        message += this->name();
+        message += ": the shares of the buffers (";
+        message += std::to_string(m_shares);
+        message += " bytes) are larger than the pool, the pool limits them";
+        SC_REPORT_WARNING(MODULE_ID_STR, message.c_str());
+    }
+}
+
+/** @brief register a buffer, during elaboration
+ *
+ * @param name name of the buffer, for trace and summary
+ * @param share bytes of the pool the buffer gets, see "policy"
+ *
+ * @return id of the buffer for the other calls
+ */
+int SharedMemoryPool::attach(const std::string& name, int share)
+{
+    m_clients.push_back(Client());
+    Client& client = m_clients.back();
+    client.name = name;
+    client.share = share;
+    m_shares += share;
+
+    if (m_traceOn) {
+        m_csvTrace->trace(client.used, std::string(this->name()).append(".").append(name).append(".used"), "used in Bytes");
+        m_csvTrace->trace(client.underruns, std::string(this->name()).append(".").append(name).append(".underruns"), "underruns");
+        m_csvTrace->trace(client.blocked, std::string(this->name()).append(".").append(name).append(".blocked"), "writes blocked by the pool");
+    }
+    return m_clients.size() - 1;
+}
+
+/** @brief bytes of a buffer above its share
+ *
+ */
+int SharedMemoryPool::burst(const Client& client, int used) const
+{
+    return std::max(0, used - client.share);
+}
+
+/** @brief take bytes out of the pool for a buffer, if the policy allows it.
+ *
+ * The caller waits for @freeEvent() and tries again, if not.
+ *
+ * @return true if the bytes are allocated
+ */
+bool SharedMemoryPool::allocate(int id, int bytes)
+{
+    Client& client = m_clients[id];
+    bool allowed = this->used + bytes <= m_size;
+
+    if (allowed && m_policy == POLICY_STATIC) {
+        allowed = client.used + bytes <= client.share;
+    } else if (allowed && m_policy == POLICY_GUARANTEED) {
+        // the bytes nobody has a share of are shared
+        int burst = m_burst - this->burst(client, client.used) + this->burst(client, client.used + bytes);
+        allowed = burst <= std::max(0, m_size - m_shares);
+    }
+
+    if (!allowed) {
+        if (!client.waiting) {
+            client.waiting = true;
+            client.blocked++;
+            this->blocked++;
+        }
+        return false;
+    }
+
+    client.waiting = false;
+    m_burst += this->burst(client, client.used + bytes) - this->burst(client, client.used);
+    client.used += bytes;
+    client.peak = std::max(client.peak, client.used);
+    this->used += bytes;
+    this->peak = std::max(this->peak, this->used);
+    return true;
+}
+
+/** @brief give bytes of a buffer back to the pool
+ *
+ */
+void SharedMemoryPool::free(int id, int bytes)
+{
+    Client& client = m_clients[id];
+    m_burst += this->burst(client, client.used - bytes) - this->burst(client, client.used);
+    client.used -= bytes;
+    this->used -= bytes;
+    m_freeEvent.notify();
+}
+
+/** @brief count an underrun of a buffer
+ *
+ */
+void SharedMemoryPool::underrun(int id)
+{
+    m_clients[id].underruns++;
+    this->underruns++;
+}
+
+const sc_event& SharedMemoryPool::freeEvent() const
+{
+    return m_freeEvent;
+}
+
+/** @brief print peak, underruns and blocked writes of every buffer, and of the whole pool
+ *
+ */
+void SharedMemoryPool::report()
+{
+    for (size_t i = 0; i < m_clients.size(); i++) {
+        std::string message;
+        message += this->name();
+        message += " (";
+        message += m_policyName;
+        message += ") ";
+        message += m_clients[i].name;
+        message += ": share: ";
+        message += std::to_string(m_clients[i].share);
+        message += " peak: ";
+        message += std::to_string(m_clients[i].peak);
+        message += " underruns: ";
+        message += std::to_string(m_clients[i].underruns);
+        message += " blocked: ";
+        message += std::to_string(m_clients[i].blocked);
+        SC_REPORT_INFO(MODULE_ID_STR, message.c_str());
+    }
+    std::string message;
+    message += this->name();
+    message += " (";
+    message += m_policyName;
+    message += "): size: ";
+    message += std::to_string(m_size);
+    message += " peak: ";
+    message += std::to_string(this->peak);
+    message += " underruns: ";
+    message += std::to_string(this->underruns);
+    message += " blocked: ";
+    message += std::to_string(this->blocked);
+    SC_REPORT_INFO(MODULE_ID_STR, message.c_str());
+}
+
+/** @brief print the summary of every pool, call it after the simulation
+ *
+ */
+void SharedMemoryPool::reportAll()
+{
+    for (size_t i = 0; i < pools().size(); i++) {
+        pools()[i]->report();
+    }
+}
+
+#undef MODULE_ID_STR
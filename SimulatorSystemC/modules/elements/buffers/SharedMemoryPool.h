@@ -0,0 +1,116 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file a RAM pool, that several buffers allocate their elements from, under one budget.
+ *
+ * Instead of a fixed "size" per buffer, the buffers attached to the pool share "size" bytes. The "size" of
+ * a buffer is then its share of the pool, used depending on the "policy":
+ *     "static"      a buffer never holds more than its share (default, the same as without a pool)
+ *     "firstCome"   a buffer holds as much as is free in the pool, the shares are ignored
+ *     "guaranteed"  a buffer always gets its share. Above it, it bursts into the bytes of the pool nobody
+ *                   has a share of, first come first served
+ *
+ * Per buffer the pool counts the underruns (the reader found the buffer empty) and how often the writer was
+ * blocked by the pool, so the policies can be compared in the trace and in the summary sc_main prints at the end
+ * with reportAll().
+ */
+
+#ifndef BUFFERS_SHAREDMEMORYPOOL_H_
+#define BUFFERS_SHAREDMEMORYPOOL_H_
+
+#include "systemc.h"
+#include "framework/CsvTrace.h"
+#include <deque>
+#include <vector>
+#include <memory>
+#include <string>
+
+class SharedMemoryPoolIf {
+public:
+    virtual int attach(const std::string& name, int share) = 0; // register a buffer, returns its id
+    virtual bool allocate(int client, int bytes) = 0;           // noblocking, false if the policy doesn't allow it now
+    virtual void free(int client, int bytes) = 0;
+    virtual void underrun(int client) = 0;                       // the reader of the buffer found it empty
+    virtual const sc_event& freeEvent() const = 0;               // notified when bytes are freed
+    virtual ~SharedMemoryPoolIf() {
+    };
+};
+
+class SharedMemoryPool
+    : public sc_core::sc_prim_channel
+    , public SharedMemoryPoolIf {
+public:
+    SharedMemoryPool(const char* name);
+    virtual ~SharedMemoryPool();
+
+    int attach(const std::string& name, int share);
+    bool allocate(int client, int bytes);
+    void free(int client, int bytes);
+    void underrun(int client);
+    const sc_event& freeEvent() const;
+
+    void report();
+    static void reportAll();
+
+    int used = 0;
+    int peak = 0;
+    int underruns = 0;
+    int blocked = 0;
+
+private:
+    enum Policy {
+        POLICY_STATIC,
+        POLICY_FIRST_COME,
+        POLICY_GUARANTEED
+    };
+
+    struct Client {
+        std::string name;
+        int share;
+        int used = 0;
+        int peak = 0;
+        int underruns = 0;
+        int blocked = 0;
+        bool waiting = false;   // the last allocate() failed
+    };
+
+    static std::vector<SharedMemoryPool*>& pools();
+
+    void loadConfig();
+    void end_of_elaboration();
+    int burst(const Client& client, int used) const;
+
+    int m_size;
+    Policy m_policy = POLICY_STATIC;
+    std::string m_policyName = "static";
+    int m_shares = 0;           // sum of the shares of all buffers
+    int m_burst = 0;            // bytes above the shares, with "guaranteed"
+    std::deque<Client> m_clients; // deque, the traces point into the elements
+
+    sc_event m_freeEvent;
+
+    bool m_traceOn = false;
+    std::shared_ptr<CsvTrace> m_csvTrace;
+};
+
+#endif /* BUFFERS_SHAREDMEMORYPOOL_H_ */
@@ -0,0 +1,181 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file high and low watermark events of a buffer channel.
+ *
+ * Configured with "highWatermark" and "lowWatermark" in the unit of the "fill" of the buffer. The high
+ * event is notified when fill rises to or above the high watermark, the low event when it drops to or below
+ * the low watermark. So a reader can wait for a start threshold, like the bitstream buffer of a decoder,
+ * and a writer for room to refill, instead of waking up on every element.
+ *
+ * Without configuration the high watermark is 0 and the low watermark is the size of the buffer, so
+ * waitHigh() and waitLow() return at once.
+ *
+ * The buffer may not get up to the high watermark: a writer blocks as soon as the next element does not fit
+ * (e.g. a large frame in a byte counted buffer, or the gap at the end of a ring), and at the end of the stream
+ * nothing is written any more. So waitHigh() also returns while a writer is blocked (see writerBlocked()), and
+ * when fill is above 0 but nothing was written for "highWatermarkTimeout" seconds (optional, 1 second by
+ * default, 0 waits without timeout).
+ */
+
+#ifndef BUFFERS_WATERMARKS_H_
+#define BUFFERS_WATERMARKS_H_
+
+#include "systemc.h"
+#include "rapidjson/document.h"
+#include <string>
+
+class Watermarks {
+public:
+    /** @brief read "highWatermark" and "lowWatermark" out of the configuration of a buffer
+     *
+     * @param s the configuration of the buffer
+     * @param name name of the buffer
+     * @param moduleId id of the buffer for the reports
+     * @param size size of the buffer, the default low watermark. Neither watermark may be above it, a
+     *             reader waiting for a high watermark the buffer can't reach would block forever
+     */
+    void loadConfig(rapidjson::Value& s, const char* name, const char* moduleId, int size) {
+        m_high = 0;
+        m_low = size;
+        parse(s, "highWatermark", m_high, name, moduleId, size);
+        parse(s, "lowWatermark", m_low, name, moduleId, size);
+
+        if (s.HasMember("highWatermarkTimeout")) {
+            if (!s["highWatermarkTimeout"].IsNumber() || s["highWatermarkTimeout"].GetDouble() < 0) {
+                std::string message;
+                message += "Malformed configuration of \"";
+                message += name;
+                message += "\". \"highWatermarkTimeout\" is no Number or negative";
+                SC_REPORT_FATAL(moduleId, message.c_str());
+            }
+            m_timeout = sc_time(s["highWatermarkTimeout"].GetDouble(), SC_SEC);
+        }
+    }
+
+    /** @brief notify the events, if the change of fill crosses a watermark
+     */
+    void update(int before, int after) {
+        if (after > before) {
+            m_lastWrite = sc_time_stamp();
+            if (before == 0) {
+                m_filledEvent.notify();
+            }
+        }
+        if (before < m_high && after >= m_high) {
+            m_highEvent.notify();
+        }
+        if (before > m_low && after <= m_low) {
+            m_lowEvent.notify();
+        }
+    }
+
+    /** @brief a writer of the buffer blocks (true) or goes on (false). A blocked writer releases waitHigh(),
+     * the buffer can't get any fuller before the reader takes something out.
+     */
+    void writerBlocked(bool blocked) {
+        m_writerBlocked = blocked;
+        if (blocked) {
+            m_highEvent.notify();
+        }
+    }
+
+    /** @brief block till fill is at or above the high watermark, a writer is blocked, or the writing stopped
+     * for the timeout
+     */
+    void waitHigh(const int& fill) {
+        while (fill < m_high && !m_writerBlocked) {
+            if (m_timeout == SC_ZERO_TIME) {
+                wait(m_highEvent);
+            } else if (fill == 0) {
+                // the timeout starts with the first element
+                wait(m_highEvent | m_filledEvent);
+            } else if (sc_time_stamp() >= m_lastWrite + m_timeout) {
+                return;
+            } else {
+                wait(m_lastWrite + m_timeout - sc_time_stamp(), m_highEvent);
+            }
+        }
+    }
+
+    /** @brief block till fill is at or below the low watermark
+     */
+    void waitLow(const int& fill) {
+        while (fill > m_low) {
+            wait(m_lowEvent);
+        }
+    }
+
+    const sc_event& highEvent() const {
+        return m_highEvent;
+    }
+
+    const sc_event& lowEvent() const {
+        return m_lowEvent;
+    }
+
+    int high() const {
+        return m_high;
+    }
+
+    int low() const {
+        return m_low;
+    }
+
+private:
+    void parse(rapidjson::Value& s, const char* id, int& value, const char* name, const char* moduleId, int size) {
+        if (!s.HasMember(id)) {
+            return;
+        }
+        if (!s[id].IsInt() || s[id].GetInt() < 0) {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += name;
+            message += "\". \"";
+            message += id;
+            message += "\" is no Int or negative";
+            SC_REPORT_FATAL(moduleId, message.c_str());
+        }
+        if (s[id].GetInt() > size) {
+            std::string message;
+            message += "Malformed configuration of \"";
+            message += name;
+            message += "\". \"";
+            message += id;
+            message += "\" is larger than \"size\"";
+            SC_REPORT_FATAL(moduleId, message.c_str());
+        }
+        value = s[id].GetInt();
+    }
+
+    int m_high = 0;
+    int m_low = 0;
+    sc_time m_timeout = sc_time(1, SC_SEC); // SC_ZERO_TIME means no timeout
+    sc_time m_lastWrite = SC_ZERO_TIME;
+    bool m_writerBlocked = false;
+    sc_event m_highEvent;
+    sc_event m_lowEvent;
+    sc_event m_filledEvent; /** fill rose from 0 */
+};
+
+#endif /* BUFFERS_WATERMARKS_H_ */
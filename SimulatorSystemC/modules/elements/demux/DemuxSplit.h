@@ -32,10 +32,13 @@
 #define DEMUXSPLIT_H_
 
 #include <modules/elements/buffers/BufferFiFo.h>
+#include <modules/elements/demux/PesArena.h>
+#include <modules/elements/input/TsPacketFormat.h>
 #include "systemc.h"
 #include "mpeg/ts.h"
 #include "mpeg/pes.h"
 #include "framework/Configuration.h"
+#include "framework/AllocationTracker.h"
 #include <stdint.h>
 #include <vector>
 #include <algorithm>
@@ -43,8 +46,6 @@
 #include <map>
 #include "../buffers/BufferDecoder.h"
 
-#define PES_BUFFER_SIZE 8000000 //8MB
-
 #define MODULE_ID_STR "/digisoft/simulator/modules/elements/demux/DemuxSplit"
 
 
@@ -72,6 +73,7 @@ SC_MODULE(DemuxSplit)
     int pcrPid;
     std::map<int,int> ccCounter;
     int bufferSize;
+    TsPacketFormat packetFormat = TS_PACKET_FORMAT_TS; /** layout of the packets in the buffers from the input, set by the reader */
 
     int pesVideoBufferFill = 0;
     int pesVideoPacketSize = 0;/** just for logging **/
@@ -80,10 +82,10 @@ SC_MODULE(DemuxSplit)
     int pesAudioPacketSize = 0;/** just for logging **/
 
 private:
-    uint8_t* pesVideoBuffer;
+    PesArena pesVideoArena; /** the PES in assembly, and the ones still used by the decoder */
     bool pesVideoBufferInit = false;
 
-    uint8_t* pesAudioBuffer;
+    PesArena pesAudioArena; /** the PES in assembly, and the ones still used by the decoder */
     bool pesAudioBufferInit = false;
 
 
@@ -214,7 +216,7 @@ public:
      * This function gets the TS packates and saves the payload until it gets a full PES packet.
      * It saves the pes payload together with the pts to the next Buffer
      *
-     * @param tsPacket pointer to the 188 byte Transport stream packet
+     * @param tsPacket pointer to the 188 byte Transport stream packet (the TS part of the packet from the input)
      *
      */
     void fillVideoESPacket(uint8_t* tsPacket) {
@@ -227,6 +229,7 @@ public:
             if(pesVideoBufferInit)
             {
 
+                uint8_t* pesVideoBuffer = pesVideoArena.data();
                 if (pes_validate_header(pesVideoBuffer) && pes_has_pts(pesVideoBuffer) && pes_validate_pts(pesVideoBuffer))
                 {
 
@@ -236,8 +239,8 @@ public:
                     this->pesVideoPacketSize = pesVideoBufferFill;
                     int pesPayloadSize = pesVideoBufferFill - (pesPayloadStart - pesVideoBuffer);
 
-                    uint8_t* pesPayload = new uint8_t[pesPayloadSize];
-                    memcpy(pesPayload, pesPayloadStart, pesPayloadSize);
+                    // handed on in place, the block is reused when the decoder is done with it
+                    std::shared_ptr<uint8_t> pesPayload = pesVideoArena.slice(pesPayloadStart - pesVideoBuffer);
 
                     stcSendRequ.write(true);
                     wait(stcGet.default_event());
@@ -259,20 +262,19 @@ public:
                 {
                     SC_REPORT_WARNING(MODULE_ID_STR,"invalid pes packet Video");
                 }
-                delete[] pesVideoBuffer;
             }
             else
             {
                 pesVideoBufferInit = true;
             }
-            pesVideoBuffer = new uint8_t[PES_BUFFER_SIZE];
+            pesVideoArena.begin();
             pesVideoBufferFill = 0;
         }
 
         uint8_t* tsPayload = ts_payload(tsPacket);
         int tsPayloadSize = TS_SIZE - (tsPayload - tsPacket);
 
-        memcpy(pesVideoBuffer+pesVideoBufferFill, tsPayload, tsPayloadSize);
+        pesVideoArena.append(tsPayload, tsPayloadSize);
         pesVideoBufferFill += tsPayloadSize;
     }
 
@@ -281,7 +283,7 @@ public:
      * This function gets the TS packates and saves the payload until it gets a full PES packet.
      * It saves the pes payload together with the pts to the next Buffer
      *
-     * @param tsPacket pointer to the 188 byte Transport stream packet
+     * @param tsPacket pointer to the 188 byte Transport stream packet (the TS part of the packet from the input)
      *
      */
     void fillAudioESPacket(uint8_t* tsPacket) {
@@ -294,6 +296,7 @@ public:
             if(pesAudioBufferInit)
             {
 
+                uint8_t* pesAudioBuffer = pesAudioArena.data();
                 if (pes_validate_header(pesAudioBuffer) && pes_has_pts(pesAudioBuffer) && pes_validate_pts(pesAudioBuffer))
                 {
 
@@ -303,8 +306,8 @@ public:
                     this->pesAudioPacketSize = pesAudioBufferFill;
                     int pesPayloadSize = pesAudioBufferFill - (pesPayloadStart - pesAudioBuffer);
 
-                    uint8_t* pesPayload = new uint8_t[pesPayloadSize];
-                    memcpy(pesPayload, pesPayloadStart, pesPayloadSize);
+                    // handed on in place, the block is reused when the decoder is done with it
+                    std::shared_ptr<uint8_t> pesPayload = pesAudioArena.slice(pesPayloadStart - pesAudioBuffer);
 
                     stcSendRequ.write(true);
                     wait(stcGet.default_event());
@@ -325,20 +328,19 @@ public:
                 {
                     SC_REPORT_WARNING(MODULE_ID_STR,"invalid pes packet Audio");
                 }
-                delete[] pesAudioBuffer;
             }
             else
             {
                 pesAudioBufferInit = true;
             }
-            pesAudioBuffer = new uint8_t[PES_BUFFER_SIZE];
+            pesAudioArena.begin();
             pesAudioBufferFill = 0;
         }
 
         uint8_t* tsPayload = ts_payload(tsPacket);
         int tsPayloadSize = TS_SIZE - (tsPayload - tsPacket);
 
-        memcpy(pesAudioBuffer+pesAudioBufferFill, tsPayload, tsPayloadSize);
+        pesAudioArena.append(tsPayload, tsPayloadSize);
         pesAudioBufferFill += tsPayloadSize;
     }
 
@@ -350,6 +352,26 @@ public:
      * to the STC.
      */
     void demuxPoc() {
+        // the reader sets the layout of its packets at the buffer
+        this->packetFormat = in->packetFormat();
+        switch (this->packetFormat) {
+            case TS_PACKET_FORMAT_M2TS:
+                demuxPackets<TsFormatM2ts>();
+                break;
+            case TS_PACKET_FORMAT_TS204:
+                demuxPackets<TsFormatTs204>();
+                break;
+            default:
+                demuxPackets<TsFormatTs>();
+        }
+    }
+
+    /** @brief the demux loop, for one packet format.
+     *
+     * @tparam Format TsPacketLayout of the packets in the buffers
+     */
+    template<class Format>
+    void demuxPackets() {
         int64_t pcr;
         uint8_t* tsBuffer;
         uint8_t* tsPacket;
@@ -357,10 +379,10 @@ public:
         while (true) {
             getBuffer(tsBuffer, bufferSize);
 
-            for (int i = 0; (i+1)*TS_SIZE <= bufferSize; i++)
+            for (size_t i = 0; (i+1)*Format::packetSize <= (size_t)bufferSize; i++)
             {
 
-                tsPacket = tsBuffer + i*TS_SIZE;
+                tsPacket = tsBuffer + i*Format::packetSize + Format::headerOffset;
 
                 int pid = ts_get_pid(tsPacket);
 
@@ -412,7 +434,7 @@ public:
     virtual void getBuffer(uint8_t*& buffer, int& bufferSize)
     {
         in->read(buffer);
-        bufferSize = TS_SIZE;
+        bufferSize = tsPacketFormatSize(this->packetFormat);
     }
 
     /** @brief this function cares about releasing a buffer after the Demux dealt with it.
@@ -421,7 +443,7 @@ public:
      */
     virtual void releaseBuffer(uint8_t*& buffer)
     {
-        delete[] buffer;
+        in->release(buffer);
         buffer = NULL;
     }
 
@@ -433,13 +455,15 @@ public:
         in("in")
     {
         this->loadConfig();
+        std::shared_ptr<AllocationAccount> account = AllocationTracker::getInstance().account(this->name());
+        pesVideoArena.setAccount(account);
+        pesAudioArena.setAccount(account);
         SC_THREAD(demuxPoc);
     }
 
 
 };
 #undef MODULE_ID_STR
-#undef PES_BUFFER_SIZE
 
 #endif //DEMUXSPLIT_H_
 
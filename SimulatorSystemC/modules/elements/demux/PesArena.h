@@ -0,0 +1,197 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file reusable memory to assemble PES packets in, handing out reference counted slices of them.
+ *
+ * A PES is assembled in one block of the arena. When it is complete, the part downstream needs (the PES
+ * payload) is handed out as a slice: a shared_ptr pointing into the block, that shares the reference count
+ * of the whole block (aliasing constructor). So the payload is not copied again, and the block is reused
+ * for a later PES as soon as all slices of it are gone.
+ *
+ * Blocks come in power of two sizes, from PES_ARENA_MIN_SIZE on. A new PES gets the smallest free block
+ * that holds the former PES of the stream. A block grows to the size class of the PES_packet_length in the
+ * header, or of the bytes appended, for video PES without length. So a small audio PES only pins a small block. At most
+ * PES_ARENA_SPARE_BLOCKS unreferenced blocks are kept for reuse, larger ones are freed first.
+ * The blocks are charged to the AllocationAccount set with setAccount().
+ */
+
+#ifndef DEMUX_PESARENA_H_
+#define DEMUX_PESARENA_H_
+
+#include "framework/AllocationTracker.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+#define PES_ARENA_MIN_SIZE 2048   /** capacity of the smallest block */
+#define PES_ARENA_SPARE_BLOCKS 4  /** unreferenced blocks kept for the next PES */
+#define PES_ARENA_HEADER_SIZE 6   /** start code, stream id and PES_packet_length */
+
+class PesArena {
+public:
+    ~PesArena() {
+        if (m_account) {
+            m_account->free(bytes());
+        }
+    }
+
+    /** @brief charge the blocks to account, the ones allocated already and all later ones */
+    void setAccount(const std::shared_ptr<AllocationAccount>& account) {
+        m_account = account;
+        m_account->allocate(bytes());
+    }
+
+    /** @brief start a new PES, the bytes of the former one are dropped.
+     *
+     * The PES goes into the smallest block that is not referenced by any slice, and holds the former PES.
+     */
+    void begin() {
+        size_t wanted = blockSize(m_fill);
+        m_fill = 0;
+        m_expected = 0;
+
+        size_t best = m_blocks.size();
+        for (size_t i = 0; i < m_blocks.size(); i++) {
+            size_t size = m_blocks[i]->size();
+            if (m_blocks[i].use_count() == 1 && size >= wanted
+                && (best == m_blocks.size() || size < m_blocks[best]->size())) {
+                best = i;
+            }
+        }
+        if (best == m_blocks.size()) {
+            m_blocks.push_back(std::make_shared<std::vector<uint8_t> >(wanted));
+            if (m_account) {
+                m_account->allocate(wanted);
+            }
+        }
+        m_current = best;
+        trim();
+    }
+
+    /** @brief add bytes to the current PES, the block grows if needed */
+    void append(const uint8_t* data, size_t size) {
+        if (m_fill == 0 && size >= PES_ARENA_HEADER_SIZE && data[0] == 0 && data[1] == 0 && data[2] == 1) {
+            // 0 for video PES of unknown length
+            size_t length = (data[4] << 8) | data[5];
+            m_expected = length ? PES_ARENA_HEADER_SIZE + length : 0;
+        }
+
+        std::vector<uint8_t>& block = *m_blocks[m_current];
+        if (m_fill + size > block.size()) {
+            // nobody holds a slice of the current block, so it may move
+            size_t before = block.size();
+            block.resize(blockSize(std::max(m_fill + size, m_expected)));
+            if (m_account) {
+                m_account->allocate(block.size());
+                m_account->free(before);
+            }
+        }
+        memcpy(block.data() + m_fill, data, size);
+        m_fill += size;
+    }
+
+    /** @brief the current PES, valid till the next append() or begin() */
+    uint8_t* data() {
+        return m_blocks[m_current]->data();
+    }
+
+    /** @brief amount of bytes in the current PES */
+    size_t size() const {
+        return m_fill;
+    }
+
+    /** @brief hand out the current PES from offset on, without copying.
+     *
+     * The block of the current PES is not used again (and may not grow), until the slice and all its
+     * copies are gone. So nothing must be appended after this call, before the next begin().
+     */
+    std::shared_ptr<uint8_t> slice(size_t offset) {
+        return std::shared_ptr<uint8_t>(m_blocks[m_current], m_blocks[m_current]->data() + offset);
+    }
+
+    /** @brief amount of blocks, that is the most PES held at the same time plus the spare ones */
+    size_t blocks() const {
+        return m_blocks.size();
+    }
+
+    /** @brief bytes allocated by all blocks */
+    size_t bytes() const {
+        size_t bytes = 0;
+        for (size_t i = 0; i < m_blocks.size(); i++) {
+            bytes += m_blocks[i]->size();
+        }
+        return bytes;
+    }
+
+private:
+    /** @brief the size class for a PES of size bytes */
+    static size_t blockSize(size_t size) {
+        size_t block = PES_ARENA_MIN_SIZE;
+        while (block < size) {
+            block <<= 1;
+        }
+        return block;
+    }
+
+    /** @brief free the largest unreferenced blocks, till PES_ARENA_SPARE_BLOCKS are left */
+    void trim() {
+        std::vector<size_t> spare;
+        for (size_t i = 0; i < m_blocks.size(); i++) {
+            if (i != m_current && m_blocks[i].use_count() == 1) {
+                spare.push_back(i);
+            }
+        }
+        if (spare.size() <= PES_ARENA_SPARE_BLOCKS) {
+            return;
+        }
+        std::sort(spare.begin(), spare.end(), [this](size_t a, size_t b) {
+            return m_blocks[a]->size() > m_blocks[b]->size();
+        });
+        spare.resize(spare.size() - PES_ARENA_SPARE_BLOCKS);
+        std::sort(spare.begin(), spare.end());
+
+        // erase from the back, so the indices in front stay valid
+        for (std::vector<size_t>::reverse_iterator it = spare.rbegin(); it != spare.rend(); ++it) {
+            if (m_account) {
+                m_account->free(m_blocks[*it]->size());
+            }
+            m_blocks.erase(m_blocks.begin() + *it);
+            if (*it < m_current) {
+                m_current--;
+            }
+        }
+    }
+
+    std::vector<std::shared_ptr<std::vector<uint8_t> > > m_blocks;
+    size_t m_current = 0;
+    size_t m_fill = 0;
+    size_t m_expected = 0; /** size of the current PES from its header, 0 if unknown */
+    std::shared_ptr<AllocationAccount> m_account;
+};
+
+#undef PES_ARENA_MIN_SIZE
+#undef PES_ARENA_SPARE_BLOCKS
+#undef PES_ARENA_HEADER_SIZE
+#endif /* DEMUX_PESARENA_H_ */
@@ -0,0 +1,127 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file copy on write memory map of a whole file.
+ */
+
+#ifndef INPUT_MAPPEDFILE_H_
+#define INPUT_MAPPEDFILE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/** @brief maps a file copy on write into memory.
+ *
+ * The pages are the ones of the page cache, so several simulations reading the same file share them. Writing
+ * to the mapping is allowed, but the written page becomes a private copy, the file itself is never changed.
+ */
+class MappedFile {
+public:
+    MappedFile() {
+    };
+
+    ~MappedFile() {
+        close();
+    }
+
+    /** @brief map the given file.
+     *
+     * @param filename file to map
+     * @param sequential if true, tell the kernel the file will be read from start to end, so it reads ahead aggressively
+     *
+     * @return true if the file could be mapped, false otherwise
+     */
+    bool open(const std::string& filename, bool sequential = true) {
+        close();
+
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0) {
+            ::close(fd);
+            return false;
+        }
+
+        m_size = fileStat.st_size;
+        if (m_size > 0) {
+            void* data = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                ::close(fd);
+                m_size = 0;
+                return false;
+            }
+            m_data = (uint8_t*)data;
+            if (sequential) {
+                madvise(data, m_size, MADV_SEQUENTIAL);
+            }
+        }
+
+        // the mapping stays valid after closing the descriptor
+        ::close(fd);
+        m_open = true;
+        return true;
+    }
+
+    void close() {
+        if (m_data) {
+            munmap(m_data, m_size);
+        }
+        m_data = NULL;
+        m_size = 0;
+        m_open = false;
+    }
+
+    bool isOpen() const {
+        return m_open;
+    }
+
+    const uint8_t* data() const {
+        return m_data;
+    }
+
+    uint8_t* data() {
+        return m_data;
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+private:
+    MappedFile(const MappedFile&);             // disable copy
+    MappedFile& operator= (const MappedFile&); // disable =
+
+    uint8_t* m_data = NULL;
+    size_t m_size = 0;
+    bool m_open = false;
+};
+
+#endif /* INPUT_MAPPEDFILE_H_ */
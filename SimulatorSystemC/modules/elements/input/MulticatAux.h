@@ -0,0 +1,102 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file access to the timestamps of a multicat aux file.
+ *
+ * multicat writes one 8 byte big endian 27MHz timestamp per TS packet into the aux file. The file is
+ * mapped into memory and decoded in blocks into an array of 64 bit values.
+ */
+
+#ifndef INPUT_MULTICATAUX_H_
+#define INPUT_MULTICATAUX_H_
+
+#include <modules/elements/input/MappedFile.h>
+#include <algorithm>
+#include <endian.h>
+#include <cstring>
+#include <vector>
+
+#define MULTICAT_AUX_SIZE 8 /** bytes per timestamp */
+#define MULTICAT_AUX_DECODE_BLOCK 4096 /** timestamps decoded at once */
+
+class MulticatAux {
+public:
+    bool open(const std::string& filename) {
+        m_first = 0;
+        m_stc.clear();
+        return m_file.open(filename, true);
+    }
+
+    /** @brief amount of timestamps in the file
+     */
+    size_t size() const {
+        return m_file.size() / MULTICAT_AUX_SIZE;
+    }
+
+    /** @brief get the timestamp of a packet. The file is meant to be read from start to end.
+     *
+     * @param[in] index number of the packet
+     * @param[out] stc the 27MHz timestamp
+     *
+     * @return false if there is no timestamp for the packet
+     */
+    bool get(size_t index, uint64_t& stc) {
+        if (index < m_first || index >= m_first + m_stc.size()) {
+            if (!decode(index)) {
+                return false;
+            }
+        }
+        stc = m_stc[index - m_first];
+        return true;
+    }
+
+private:
+    /** @brief decode the block of timestamps starting at index.
+     *
+     * compare to mulitcat util.h FromSTC()
+     */
+    bool decode(size_t index) {
+        if (index >= size()) {
+            return false;
+        }
+
+        size_t count = std::min((size_t)MULTICAT_AUX_DECODE_BLOCK, size() - index);
+        const uint8_t* data = m_file.data() + index * MULTICAT_AUX_SIZE;
+        m_stc.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            uint64_t value;
+            memcpy(&value, data + i * MULTICAT_AUX_SIZE, MULTICAT_AUX_SIZE);
+            m_stc[i] = be64toh(value);
+        }
+        m_first = index;
+        return true;
+    }
+
+    MappedFile m_file;
+    std::vector<uint64_t> m_stc;
+    size_t m_first = 0; /** index of the packet m_stc[0] belongs to */
+};
+
+#undef MULTICAT_AUX_SIZE
+#undef MULTICAT_AUX_DECODE_BLOCK
+#endif /* INPUT_MULTICATAUX_H_ */
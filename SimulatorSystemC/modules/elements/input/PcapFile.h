@@ -0,0 +1,392 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file reads the UDP datagrams out of a pcap or pcapng capture.
+ *
+ * The capture is mapped into memory, and the records are parsed in place. Ethernet (with VLAN tags), Linux
+ * cooked (SLL), BSD loopback and raw IP link layers are understood, with IPv4 or IPv6 and UDP on top.
+ * Fragmented IP packets and non UDP packets are skipped.
+ */
+
+#ifndef INPUT_PCAPFILE_H_
+#define INPUT_PCAPFILE_H_
+
+#include <modules/elements/buffers/BufferFill.h>
+#include <modules/elements/input/MappedFile.h>
+#include <algorithm>
+#include <byteswap.h>
+#include <cstring>
+#include <map>
+#include <stdint.h>
+
+#define PCAP_MAGIC_US 0xa1b2c3d4
+#define PCAP_MAGIC_NS 0xa1b23c4d
+#define PCAP_HEADER_SIZE 24
+#define PCAP_RECORD_HEADER_SIZE 16
+#define PCAPNG_BLOCK_SHB 0x0a0d0d0a
+#define PCAPNG_BLOCK_IDB 1
+#define PCAPNG_BLOCK_EPB 6
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1a2b3c4d
+#define PCAPNG_OPTION_TSRESOL 9
+
+#define LINKTYPE_NULL 0
+#define LINKTYPE_ETHERNET 1
+#define LINKTYPE_RAW 101
+#define LINKTYPE_IPV4 228
+#define LINKTYPE_IPV6 229
+#define LINKTYPE_LINUX_SLL 113
+
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_IPV6 0x86dd
+#define ETHERTYPE_VLAN 0x8100
+#define ETHERTYPE_QINQ 0x88a8
+#define IP_PROTOCOL_UDP 17
+#define UDP_HEADER_SIZE 8
+
+/** @brief one UDP datagram of the capture */
+struct PcapDatagram {
+    const uint8_t* payload;
+    size_t size;
+    uint64_t time;         /** capture time in nanoseconds */
+    uint16_t destinationPort;
+};
+
+/** @brief the owner of the payloads handed out. They point into the mapping, so releasing them does nothing. */
+class PcapFile : public BufferFillPacketOwnerIf {
+public:
+    /** @brief map a capture, and read its header.
+     *
+     * @return false if the file could not be mapped, or is no pcap or pcapng file
+     */
+    bool open(const std::string& filename) {
+        m_pos = 0;
+        m_interfaces.clear();
+        m_interfaceCount = 0;
+
+        if (!m_file.open(filename, true) || m_file.size() < PCAP_HEADER_SIZE) {
+            return false;
+        }
+
+        uint32_t magic;
+        memcpy(&magic, m_file.data(), 4);
+
+        if (magic == PCAPNG_BLOCK_SHB) {
+            m_pcapng = true;
+            return true;
+        }
+
+        m_pcapng = false;
+        m_swapped = (magic == bswap_32(PCAP_MAGIC_US) || magic == bswap_32(PCAP_MAGIC_NS));
+        if (m_swapped) {
+            magic = bswap_32(magic);
+        }
+        if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS) {
+            return false;
+        }
+
+        Interface& interface = m_interfaces[0];
+        interface.linkType = get32(m_file.data() + 20) & 0xffff;
+        interface.unitsPerSecond = (magic == PCAP_MAGIC_NS) ? 1000000000 : 1000000;
+        interface.shift = 0;
+        m_pos = PCAP_HEADER_SIZE;
+        return true;
+    }
+
+    /** @brief get the next UDP datagram of the capture.
+     *
+     * The payload points into the mapping, and stays valid till the file is closed.
+     *
+     * @return false at the end of the file
+     */
+    bool next(PcapDatagram& datagram) {
+        const uint8_t* frame;
+        size_t size;
+        uint64_t time;
+        int linkType;
+
+        while (nextFrame(frame, size, time, linkType)) {
+            if (udp(frame, size, linkType, datagram)) {
+                datagram.time = time;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** @brief nothing to do, the payloads belong to the mapping.
+     */
+    void release(uint8_t*) {
+    }
+
+private:
+    /** @brief link type and timestamp resolution of an interface */
+    struct Interface {
+        int linkType;
+        uint64_t unitsPerSecond; /** timestamp units per second, if shift is 0 */
+        int shift;               /** if not 0, a timestamp unit is 2^-shift seconds */
+    };
+
+    uint16_t get16(const uint8_t* p) const {
+        uint16_t value;
+        memcpy(&value, p, 2);
+        return m_swapped ? bswap_16(value) : value;
+    }
+
+    uint32_t get32(const uint8_t* p) const {
+        uint32_t value;
+        memcpy(&value, p, 4);
+        return m_swapped ? bswap_32(value) : value;
+    }
+
+    static uint16_t getBigEndian16(const uint8_t* p) {
+        return (p[0] << 8) | p[1];
+    }
+
+    /** @brief convert a timestamp of an interface to nanoseconds */
+    static uint64_t toNanoseconds(uint64_t timestamp, const Interface& interface) {
+        if (interface.shift) {
+            uint64_t mask = ((uint64_t)1 << interface.shift) - 1;
+            return (timestamp >> interface.shift) * 1000000000 + (((timestamp & mask) * 1000000000) >> interface.shift);
+        }
+        return (timestamp / interface.unitsPerSecond) * 1000000000
+            + (timestamp % interface.unitsPerSecond) * 1000000000 / interface.unitsPerSecond;
+    }
+
+    /** @brief get the next captured frame, with its link type.
+     *
+     * @return false at the end of the file, or if the file is truncated
+     */
+    bool nextFrame(const uint8_t*& frame, size_t& size, uint64_t& time, int& linkType) {
+        const uint8_t* data = m_file.data();
+        size_t fileSize = m_file.size();
+
+        if (!m_pcapng) {
+            if (fileSize - m_pos < PCAP_RECORD_HEADER_SIZE) {
+                return false;
+            }
+            const uint8_t* record = data + m_pos;
+            size = get32(record + 8);
+            if (fileSize - m_pos - PCAP_RECORD_HEADER_SIZE < size) {
+                return false;
+            }
+            const Interface& interface = m_interfaces[0];
+            time = (uint64_t)get32(record) * 1000000000 + toNanoseconds(get32(record + 4), interface);
+            frame = record + PCAP_RECORD_HEADER_SIZE;
+            linkType = interface.linkType;
+            m_pos += PCAP_RECORD_HEADER_SIZE + size;
+            return true;
+        }
+
+        while (fileSize - m_pos >= 12) {
+            const uint8_t* block = data + m_pos;
+            uint32_t type;
+            memcpy(&type, block, 4);
+
+            if (type == PCAPNG_BLOCK_SHB) {
+                // a new section, with its own byte order and interfaces
+                uint32_t byteOrder;
+                memcpy(&byteOrder, block + 8, 4);
+                m_swapped = (byteOrder == bswap_32(PCAPNG_BYTE_ORDER_MAGIC));
+                m_interfaces.clear();
+                m_interfaceCount = 0;
+            } else {
+                type = get32(block);
+            }
+
+            uint32_t length = get32(block + 4);
+            if (length < 12 || length % 4 != 0 || fileSize - m_pos < length) {
+                return false;
+            }
+            m_pos += length;
+
+            if (type == PCAPNG_BLOCK_IDB && length >= 20) {
+                addInterface(block + 8, length - 12);
+            } else if (type == PCAPNG_BLOCK_EPB && length >= 32) {
+                std::map<uint32_t, Interface>::const_iterator interface = m_interfaces.find(get32(block + 8));
+                size = get32(block + 20);
+                if (interface == m_interfaces.end() || size > length - 32) {
+                    continue;
+                }
+                time = toNanoseconds(((uint64_t)get32(block + 12) << 32) | get32(block + 16), interface->second);
+                frame = block + 28;
+                linkType = interface->second.linkType;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** @brief read an interface description block
+     *
+     * @param body the block without type and length
+     * @param size size of the body
+     */
+    void addInterface(const uint8_t* body, size_t size) {
+        Interface& interface = m_interfaces[m_interfaceCount++];
+        interface.linkType = get16(body);
+        interface.unitsPerSecond = 1000000;
+        interface.shift = 0;
+
+        size_t pos = 8;
+        while (pos + 4 <= size) {
+            uint16_t code = get16(body + pos);
+            uint16_t length = get16(body + pos + 2);
+            if (code == 0 || pos + 4 + length > size) {
+                break;
+            }
+            if (code == PCAPNG_OPTION_TSRESOL && length >= 1) {
+                uint8_t resolution = body[pos + 4];
+                if (resolution & 0x80) {
+                    interface.shift = std::min(resolution & 0x7f, 63);
+                } else {
+                    interface.unitsPerSecond = 1;
+                    for (int i = 0; i < (resolution & 0x7f) && i < 19; i++) {
+                        interface.unitsPerSecond *= 10;
+                    }
+                }
+            }
+            pos += 4 + ((length + 3) & ~3);
+        }
+    }
+
+    /** @brief strip link layer, IP and UDP header of a frame.
+     *
+     * @return false if the frame is no (unfragmented) UDP datagram
+     */
+    static bool udp(const uint8_t* frame, size_t size, int linkType, PcapDatagram& datagram) {
+        int etherType;
+
+        switch (linkType) {
+            case LINKTYPE_ETHERNET:
+                if (size < 14) {
+                    return false;
+                }
+                etherType = getBigEndian16(frame + 12);
+                frame += 14;
+                size -= 14;
+                while ((etherType == ETHERTYPE_VLAN || etherType == ETHERTYPE_QINQ) && size >= 4) {
+                    etherType = getBigEndian16(frame + 2);
+                    frame += 4;
+                    size -= 4;
+                }
+                break;
+            case LINKTYPE_LINUX_SLL:
+                if (size < 16) {
+                    return false;
+                }
+                etherType = getBigEndian16(frame + 14);
+                frame += 16;
+                size -= 16;
+                break;
+            case LINKTYPE_NULL:
+                // the address family is in host byte order of the capturing machine
+                if (size < 4) {
+                    return false;
+                }
+                etherType = (frame[0] == 2 || frame[3] == 2) ? ETHERTYPE_IPV4 : ETHERTYPE_IPV6;
+                frame += 4;
+                size -= 4;
+                break;
+            case LINKTYPE_RAW:
+            case LINKTYPE_IPV4:
+            case LINKTYPE_IPV6:
+                if (size < 1) {
+                    return false;
+                }
+                etherType = ((frame[0] >> 4) == 4) ? ETHERTYPE_IPV4 : ETHERTYPE_IPV6;
+                break;
+            default:
+                return false;
+        }
+
+        if (etherType == ETHERTYPE_IPV4) {
+            if (size < 20 || (frame[0] >> 4) != 4) {
+                return false;
+            }
+            size_t headerSize = 4 * (frame[0] & 0x0f);
+            size_t totalSize = getBigEndian16(frame + 2);
+            // more fragments flag or fragment offset
+            if ((getBigEndian16(frame + 6) & 0x3fff) != 0 || frame[9] != IP_PROTOCOL_UDP
+                || headerSize < 20 || totalSize < headerSize || totalSize > size) {
+                return false;
+            }
+            frame += headerSize;
+            size = totalSize - headerSize;
+        } else if (etherType == ETHERTYPE_IPV6) {
+            // extension headers are not followed
+            if (size < 40 || (frame[0] >> 4) != 6 || frame[6] != IP_PROTOCOL_UDP) {
+                return false;
+            }
+            size_t payloadSize = getBigEndian16(frame + 4);
+            if (payloadSize > size - 40) {
+                return false;
+            }
+            frame += 40;
+            size = payloadSize;
+        } else {
+            return false;
+        }
+
+        if (size < UDP_HEADER_SIZE) {
+            return false;
+        }
+        size_t udpSize = getBigEndian16(frame + 4);
+        if (udpSize < UDP_HEADER_SIZE || udpSize > size) {
+            return false;
+        }
+        datagram.destinationPort = getBigEndian16(frame + 2);
+        datagram.payload = frame + UDP_HEADER_SIZE;
+        datagram.size = udpSize - UDP_HEADER_SIZE;
+        return true;
+    }
+
+    MappedFile m_file;
+    size_t m_pos = 0;
+    bool m_pcapng = false;
+    bool m_swapped = false;
+    std::map<uint32_t, Interface> m_interfaces;
+    uint32_t m_interfaceCount = 0;
+};
+
+#undef PCAP_MAGIC_US
+#undef PCAP_MAGIC_NS
+#undef PCAP_HEADER_SIZE
+#undef PCAP_RECORD_HEADER_SIZE
+#undef PCAPNG_BLOCK_SHB
+#undef PCAPNG_BLOCK_IDB
+#undef PCAPNG_BLOCK_EPB
+#undef PCAPNG_BYTE_ORDER_MAGIC
+#undef PCAPNG_OPTION_TSRESOL
+#undef LINKTYPE_NULL
+#undef LINKTYPE_ETHERNET
+#undef LINKTYPE_RAW
+#undef LINKTYPE_IPV4
+#undef LINKTYPE_IPV6
+#undef LINKTYPE_LINUX_SLL
+#undef ETHERTYPE_IPV4
+#undef ETHERTYPE_IPV6
+#undef ETHERTYPE_VLAN
+#undef ETHERTYPE_QINQ
+#undef IP_PROTOCOL_UDP
+#undef UDP_HEADER_SIZE
+#endif /* INPUT_PCAPFILE_H_ */
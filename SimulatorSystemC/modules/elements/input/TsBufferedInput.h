@@ -0,0 +1,153 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file base for TsInputs, that copy the file into a buffer before looking at it.
+ *
+ * Every taken packet is a copy out of a PacketPool, that goes back to the pool on release.
+ */
+
+#ifndef INPUT_TSBUFFEREDINPUT_H_
+#define INPUT_TSBUFFEREDINPUT_H_
+
+#include <modules/elements/input/TsInput.h>
+#include <modules/elements/input/TsPacketFormat.h>
+#include <modules/elements/buffers/PacketPool.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#define TS_BUFFERED_INPUT_BUFFER_SIZE (188 * 348) //~64KB
+
+/** @brief TsInput that keeps a window of the file in a buffer.
+ *
+ * Derived classes only implement how the bytes are read, with @openSource() and @readSource().
+ */
+class TsBufferedInput : public TsInput {
+public:
+    TsBufferedInput():
+        m_buffer(TS_BUFFERED_INPUT_BUFFER_SIZE),
+        m_packets(TS_PACKET_FORMAT_MAX_SIZE)
+    {
+    };
+
+    ~TsBufferedInput() {
+        if (m_account) {
+            m_account->free(m_buffer.size());
+        }
+    }
+
+    bool open(const std::string& filename, uint64_t offset = 0) {
+        m_pos = 0;
+        m_end = 0;
+        return openSource(filename, offset);
+    }
+
+    size_t peek(const uint8_t*& data, size_t size) {
+        if (m_end - m_pos < size) {
+            fillBuffer(size);
+        }
+        data = m_buffer.data() + m_pos;
+        return std::min(size, m_end - m_pos);
+    }
+
+    void skip(size_t size) {
+        while (size > 0) {
+            const uint8_t* data;
+            size_t available = peek(data, std::min(size, m_buffer.size()));
+            if (available == 0) {
+                return;
+            }
+            m_pos += available;
+            size -= available;
+        }
+    }
+
+    /** @brief the copy comes from the pool, so size must not be larger than TS_PACKET_FORMAT_MAX_SIZE
+     */
+    uint8_t* take(size_t size) {
+        const uint8_t* data;
+        if (peek(data, size) < size) {
+            return NULL;
+        }
+        uint8_t* packet = m_packets.get();
+        memcpy(packet, data, size);
+        m_pos += size;
+        return packet;
+    }
+
+    void release(uint8_t* packet) {
+        m_packets.release(packet);
+    }
+
+    void setAccount(const std::shared_ptr<AllocationAccount>& account) {
+        m_account = account;
+        m_account->allocate(m_buffer.size());
+        m_packets.setAccount(account);
+    }
+
+protected:
+    /** @brief open the file to read from, at the given byte position.
+     *
+     * @return true on success
+     */
+    virtual bool openSource(const std::string& filename, uint64_t offset) = 0;
+
+    /** @brief read up to size bytes from the file.
+     *
+     * @return amount of bytes read, 0 at the end of the file.
+     */
+    virtual size_t readSource(uint8_t* data, size_t size) = 0;
+
+private:
+    /** @brief move the unread bytes to the front of the buffer, and read from the file till there are size bytes.
+     */
+    void fillBuffer(size_t size) {
+        if (m_buffer.size() < size) {
+            if (m_account) {
+                m_account->allocate(size);
+                m_account->free(m_buffer.size());
+            }
+            m_buffer.resize(size);
+        }
+        memmove(m_buffer.data(), m_buffer.data() + m_pos, m_end - m_pos);
+        m_end -= m_pos;
+        m_pos = 0;
+
+        while (m_end < size) {
+            size_t read = readSource(m_buffer.data() + m_end, m_buffer.size() - m_end);
+            if (read == 0) {
+                return;
+            }
+            m_end += read;
+        }
+    }
+
+    std::vector<uint8_t> m_buffer;
+    PacketPool m_packets;
+    size_t m_pos = 0;
+    size_t m_end = 0;
+    std::shared_ptr<AllocationAccount> m_account;
+};
+
+#undef TS_BUFFERED_INPUT_BUFFER_SIZE
+#endif /* INPUT_TSBUFFEREDINPUT_H_ */
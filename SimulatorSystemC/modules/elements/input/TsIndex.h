@@ -0,0 +1,272 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file sidecar index of a transport stream file, to start the simulation in the middle of the file.
+ *
+ * The file is scanned once, and every PCR and every start of a video or audio PES packet is recorded with its
+ * byte position, the time since the first PCR, and whether it is a random access point. The index is saved
+ * next to the file ("<file>.tsidx"), so the scan is only needed once per file. It is rebuilt if the file size,
+ * the modification time of the file, the packet format or the PCR pid don't match.
+ *
+ * The sidecar is a cache in host byte order: a TsIndexHeader followed by the TsIndexEntries.
+ */
+
+#ifndef INPUT_TSINDEX_H_
+#define INPUT_TSINDEX_H_
+
+#include <modules/elements/input/MappedFile.h>
+#include <modules/elements/input/TsSync.h>
+#include <modules/elements/input/TsPcr.h>
+#include "mpeg/ts.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define TS_INDEX_MAGIC "TSIDX02"
+#define TS_INDEX_SUFFIX ".tsidx"
+
+#define TS_INDEX_PCR 0x01
+#define TS_INDEX_VIDEO_PES 0x02
+#define TS_INDEX_AUDIO_PES 0x04
+#define TS_INDEX_RANDOM_ACCESS 0x08 /** random access indicator set on a PES start */
+
+struct TsIndexHeader {
+    char magic[8];
+    uint64_t fileSize;
+    int64_t modified; /** modification time of the file in nanoseconds */
+    uint32_t packetSize;
+    uint32_t headerOffset;
+    int32_t pcrPid;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+struct TsIndexEntry {
+    uint64_t offset; /** byte position of the packet in the file */
+    uint64_t time;   /** 27MHz ticks since the first PCR, without jumps and warp arounds */
+    uint16_t pid;
+    uint8_t flags;
+    uint8_t reserved[5];
+};
+
+class TsIndex {
+public:
+    /** @brief load the sidecar of a file, or build and save it, if it is missing or outdated.
+     *
+     * @param filename the TS file
+     * @param packetSize size of a packet in the file
+     * @param headerOffset offset of the TS header inside a packet
+     * @param pcrPid pid carrying the PCR, or -1 to use the first pid with a PCR
+     * @param lockCount amount of consecutive sync bytes needed, if the sync got lost
+     *
+     * @return false if the file could not be read. Failing to save the sidecar is no error.
+     */
+    bool open(const std::string& filename, size_t packetSize, size_t headerOffset, int pcrPid, int lockCount) {
+        std::string sidecar = filename + TS_INDEX_SUFFIX;
+        MappedFile file;
+
+        if (!file.open(filename, true)) {
+            return false;
+        }
+        // a file rewritten in place keeps its size, but gets a new modification time
+        int64_t modified = 0;
+        struct stat status;
+        if (stat(filename.c_str(), &status) == 0) {
+            modified = (int64_t)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+        }
+        if (load(sidecar, file.size(), modified, packetSize, headerOffset, pcrPid)) {
+            return true;
+        }
+        build(file, packetSize, headerOffset, pcrPid, lockCount);
+        save(sidecar, file.size(), modified, packetSize, headerOffset, pcrPid);
+        return true;
+    }
+
+    size_t size() const {
+        return m_entries.size();
+    }
+
+    /** @brief find the byte position to start at, to see the stream from startTime on.
+     *
+     * The position is the last random access point at least preRoll seconds before startTime. If the
+     * stream doesn't signal random access points, the last video PES start is used (or audio, if there is
+     * no video).
+     *
+     * @param startTime seconds since the first PCR
+     * @param preRoll seconds to start earlier, so the buffers are filled at startTime
+     *
+     * @return byte position to start reading at, 0 if there is no start point before startTime
+     */
+    uint64_t startOffset(double startTime, double preRoll) const {
+        double start = std::max(0.0, startTime - preRoll);
+        uint64_t target = start * 27e6;
+
+        uint8_t flags = TS_INDEX_RANDOM_ACCESS;
+        if (!(m_flags & TS_INDEX_RANDOM_ACCESS)) {
+            flags = (m_flags & TS_INDEX_VIDEO_PES) ? TS_INDEX_VIDEO_PES : TS_INDEX_AUDIO_PES;
+        }
+
+        std::vector<TsIndexEntry>::const_iterator it = std::upper_bound(m_entries.begin(), m_entries.end(), target,
+            [](uint64_t value, const TsIndexEntry& entry) { return value < entry.time; });
+
+        while (it != m_entries.begin()) {
+            --it;
+            if (it->flags & flags) {
+                return it->offset;
+            }
+        }
+        return 0;
+    }
+
+private:
+    /** @brief read the sidecar, if it belongs to the file.
+     */
+    bool load(const std::string& sidecar, uint64_t fileSize, int64_t modified, size_t packetSize, size_t headerOffset,
+              int pcrPid) {
+        std::ifstream in(sidecar, std::ifstream::in | std::ifstream::binary);
+        TsIndexHeader header;
+
+        if (!in.read((char*)&header, sizeof(header))) {
+            return false;
+        }
+        if (memcmp(header.magic, TS_INDEX_MAGIC, sizeof(header.magic)) != 0 || header.fileSize != fileSize
+            || header.modified != modified || header.packetSize != packetSize || header.headerOffset != headerOffset || header.pcrPid != pcrPid) {
+            return false;
+        }
+
+        m_entries.resize(header.count);
+        if (!in.read((char*)m_entries.data(), header.count * sizeof(TsIndexEntry))) {
+            m_entries.clear();
+            return false;
+        }
+        m_flags = 0;
+        for (size_t i = 0; i < m_entries.size(); i++) {
+            m_flags |= m_entries[i].flags;
+        }
+        return true;
+    }
+
+    void save(const std::string& sidecar, uint64_t fileSize, int64_t modified, size_t packetSize, size_t headerOffset,
+              int pcrPid) const {
+        std::ofstream out(sidecar, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+        TsIndexHeader header;
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, TS_INDEX_MAGIC, sizeof(header.magic));
+        header.fileSize = fileSize;
+        header.modified = modified;
+        header.packetSize = packetSize;
+        header.headerOffset = headerOffset;
+        header.pcrPid = pcrPid;
+        header.count = m_entries.size();
+
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)m_entries.data(), m_entries.size() * sizeof(TsIndexEntry));
+    }
+
+    /** @brief scan the whole file once.
+     */
+    void build(const MappedFile& file, size_t packetSize, size_t headerOffset, int pcrPid, int lockCount) {
+        const uint8_t* data = file.data();
+        size_t size = file.size();
+        size_t pos = 0;
+        bool hasPcr = false;
+        uint64_t time = 0;
+        uint64_t lastPcr = 0;
+
+        m_entries.clear();
+        m_flags = 0;
+
+        while (pos + packetSize <= size) {
+            const uint8_t* tsPacket = data + pos + headerOffset;
+
+            if (!ts_validate(tsPacket)) {
+                bool locked;
+                pos += std::max((size_t)1, tsFindSync(data + pos, size - pos, packetSize, lockCount, headerOffset, locked));
+                continue;
+            }
+
+            TsIndexEntry entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.pid = ts_get_pid(tsPacket);
+
+            bool hasAdaptation = ts_has_adaptation(tsPacket) && (ts_get_adaptation(tsPacket) != 0);
+
+            if (hasAdaptation && tsaf_has_pcr(tsPacket) && (pcrPid < 0 || entry.pid == pcrPid)) {
+                uint64_t pcr = tsaf_get_pcr(tsPacket) * 300 + tsaf_get_pcrext(tsPacket);
+                if (!hasPcr) {
+                    hasPcr = true;
+                    pcrPid = entry.pid;
+                } else {
+                    // the time only counts forward, jumps and discontinuities are left out
+                    uint64_t delta = (pcr + TsPcr::wrap - lastPcr) % TsPcr::wrap;
+                    if (delta <= TsPcr::maxGap) {
+                        time += delta;
+                    }
+                }
+                lastPcr = pcr;
+                entry.flags |= TS_INDEX_PCR;
+            }
+
+            if (ts_get_unitstart(tsPacket) && ts_has_payload(tsPacket)) {
+                size_t payload = TS_HEADER_SIZE + (ts_has_adaptation(tsPacket) ? 1 + ts_get_adaptation(tsPacket) : 0);
+                const uint8_t* pes = tsPacket + payload;
+                if (payload + 4 <= TS_SIZE && pes[0] == 0 && pes[1] == 0 && pes[2] == 1) {
+                    uint8_t streamId = pes[3];
+                    if ((streamId & 0xf0) == 0xe0) {
+                        entry.flags |= TS_INDEX_VIDEO_PES;
+                    } else if ((streamId & 0xe0) == 0xc0 || streamId == 0xbd) {
+                        entry.flags |= TS_INDEX_AUDIO_PES;
+                    }
+                    if ((entry.flags & TS_INDEX_VIDEO_PES) && hasAdaptation && tsaf_has_randomaccess(tsPacket)) {
+                        entry.flags |= TS_INDEX_RANDOM_ACCESS;
+                    }
+                }
+            }
+
+            // everything before the first PCR has no time, and is left out
+            if (entry.flags && hasPcr) {
+                entry.offset = pos;
+                entry.time = time;
+                m_entries.push_back(entry);
+                m_flags |= entry.flags;
+            }
+            pos += packetSize;
+        }
+    }
+
+    std::vector<TsIndexEntry> m_entries;
+    uint8_t m_flags = 0; /** all flags, that occur in the index */
+};
+
+#undef TS_INDEX_MAGIC
+#undef TS_INDEX_SUFFIX
+#undef TS_INDEX_PCR
+#undef TS_INDEX_VIDEO_PES
+#undef TS_INDEX_AUDIO_PES
+#undef TS_INDEX_RANDOM_ACCESS
+#endif /* INPUT_TSINDEX_H_ */
@@ -0,0 +1,81 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file Interface for the sources the input elements read their transport stream bytes from.
+ */
+
+#ifndef INPUT_TSINPUT_H_
+#define INPUT_TSINPUT_H_
+
+#include <modules/elements/buffers/BufferFill.h>
+#include "framework/AllocationTracker.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/** @brief a byte source for a transport stream file.
+ *
+ * The input elements look at the data with @peek(), step over it with @skip(), and hand packets to the
+ * next element with @take(). A taken packet stays valid until it is given back with @release(), so the
+ * source can be registered as packet owner at a BufferFill.
+ */
+class TsInput : public BufferFillPacketOwnerIf {
+public:
+    virtual ~TsInput() {
+    };
+
+    /** @brief open the given file.
+     *
+     * @param filename the file
+     * @param offset byte position to start reading at
+     *
+     * @return true if the file could be opened, false otherwise
+     */
+    virtual bool open(const std::string& filename, uint64_t offset = 0) = 0;
+
+    /** @brief make the next bytes accessible, without consuming them.
+     *
+     * @param[out] data pointer to the bytes at the current position
+     * @param[in] size amount of bytes wanted
+     *
+     * @return amount of bytes accessible at data. Less than size only at the end of the file.
+     */
+    virtual size_t peek(const uint8_t*& data, size_t size) = 0;
+
+    /** @brief step over the next size bytes.
+     */
+    virtual void skip(size_t size) = 0;
+
+    /** @brief hand out the next size bytes as packet.
+     *
+     * @return the packet, valid until @release() is called for it. NULL if there are not enough bytes left.
+     */
+    virtual uint8_t* take(size_t size) = 0;
+
+    /** @brief charge the memory of the source to account. Sources without own buffers ignore it.
+     */
+    virtual void setAccount(const std::shared_ptr<AllocationAccount>&) {
+    };
+};
+
+#endif /* INPUT_TSINPUT_H_ */
@@ -0,0 +1,56 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file creates the TsInput for the "inputMode" of an input element.
+ */
+
+#ifndef INPUT_TSINPUTFACTORY_H_
+#define INPUT_TSINPUTFACTORY_H_
+
+#include <modules/elements/input/TsInput.h>
+#include <modules/elements/input/TsStreamInput.h>
+#include <modules/elements/input/TsMappedInput.h>
+#include <modules/elements/input/TsReadAheadInput.h>
+#include <memory>
+#include <string>
+
+/** @brief create a TsInput
+ *
+ * @param inputMode "stream" to read the file with an ifstream, "mmap" to map it into memory,
+ *        "readAhead" to read it in a separate thread
+ *
+ * @return the TsInput, or an empty pointer if inputMode is unknown
+ */
+inline std::shared_ptr<TsInput> createTsInput(const std::string& inputMode)
+{
+    if (inputMode == "stream") {
+        return std::make_shared<TsStreamInput>();
+    } else if (inputMode == "mmap") {
+        return std::make_shared<TsMappedInput>();
+    } else if (inputMode == "readAhead") {
+        return std::make_shared<TsReadAheadInput>();
+    }
+    return std::shared_ptr<TsInput>();
+}
+
+#endif /* INPUT_TSINPUTFACTORY_H_ */
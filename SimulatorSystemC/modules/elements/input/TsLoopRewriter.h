@@ -0,0 +1,192 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file rewrites the timestamps and continuity counters of a looped transport stream.
+ *
+ * When a file is played again from the start, every pass is shifted by the duration of the file: PCRs,
+ * PTSs and DTSs are increased by the accumulated offset, and the continuity counters of every pid continue
+ * where the last pass stopped. So the receiver sees one endless continuous stream.
+ *
+ * The duration of a pass is taken from the PCRs of the first pass (last - first PCR, plus the mean PCR
+ * interval). Files without PCR use the duration of the pass at the bitrate.
+ */
+
+#ifndef INPUT_TSLOOPREWRITER_H_
+#define INPUT_TSLOOPREWRITER_H_
+
+#include <modules/elements/input/TsPcr.h>
+#include "mpeg/ts.h"
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TS_LOOP_PIDS 8192
+#define TS_LOOP_PTS_WRAP ((uint64_t)1 << 33)
+
+class TsLoopRewriter {
+public:
+    TsLoopRewriter():
+        m_lastCc(TS_LOOP_PIDS, -1),
+        m_ccDelta(TS_LOOP_PIDS, 0),
+        m_seen(TS_LOOP_PIDS, false)
+    {
+    };
+
+    /** @brief amount of passes finished */
+    unsigned long loops() const {
+        return m_loops;
+    }
+
+    /** @brief start the next pass.
+     *
+     * @param passSeconds duration of the pass at the bitrate, used if the file has no PCR
+     */
+    void rewind(double passSeconds) {
+        uint64_t duration = passSeconds * 27e6;
+        if (m_pcrCount > 1) {
+            uint64_t span = m_pcrSpan;
+            duration = span + span / (m_pcrCount - 1);
+        }
+        m_offset = (m_offset + duration) % TsPcr::wrap;
+        m_loops++;
+        m_seen.assign(TS_LOOP_PIDS, false);
+    }
+
+    /** @brief rewrite a packet in place.
+     *
+     * @param tsPacket the TS packet (188 bytes), must be writable
+     */
+    void rewrite(uint8_t* tsPacket) {
+        int pid = ts_get_pid(tsPacket);
+        bool hasAdaptation = ts_has_adaptation(tsPacket) && (ts_get_adaptation(tsPacket) != 0);
+
+        if (hasAdaptation && tsaf_has_pcr(tsPacket)) {
+            uint64_t pcr = tsaf_get_pcr(tsPacket) * 300 + tsaf_get_pcrext(tsPacket);
+            if (m_loops == 0) {
+                measure(pid, pcr);
+            }
+            if (m_offset) {
+                setPcr(tsPacket, (pcr + m_offset) % TsPcr::wrap);
+            }
+        }
+
+        if (m_offset && ts_get_unitstart(tsPacket) && ts_has_payload(tsPacket)) {
+            rewritePes(tsPacket);
+        }
+
+        rewriteCc(tsPacket, pid);
+    }
+
+private:
+    /** @brief collect first and last PCR of the first pass, on the first pid carrying a PCR */
+    void measure(int pid, uint64_t pcr) {
+        if (m_pcrCount == 0) {
+            m_pcrPid = pid;
+        } else if (pid != m_pcrPid) {
+            return;
+        } else {
+            m_pcrSpan += (pcr + TsPcr::wrap - m_lastPcr) % TsPcr::wrap;
+        }
+        m_lastPcr = pcr;
+        m_pcrCount++;
+    }
+
+    static void setPcr(uint8_t* tsPacket, uint64_t pcr) {
+        uint64_t base = pcr / 300;
+        uint64_t ext = pcr % 300;
+        uint8_t* p = tsPacket + 6;
+        p[0] = base >> 25;
+        p[1] = base >> 17;
+        p[2] = base >> 9;
+        p[3] = base >> 1;
+        p[4] = ((base << 7) & 0x80) | 0x7e | ((ext >> 8) & 0x01);
+        p[5] = ext & 0xff;
+    }
+
+    static uint64_t getTimestamp(const uint8_t* p) {
+        return ((uint64_t)(p[0] & 0x0e) << 29) | (p[1] << 22) | ((p[2] & 0xfe) << 14) | (p[3] << 7) | (p[4] >> 1);
+    }
+
+    /** @brief write a timestamp, keeping the 4 bit prefix and the marker bits */
+    static void setTimestamp(uint8_t* p, uint64_t ts) {
+        p[0] = (p[0] & 0xf0) | ((ts >> 29) & 0x0e) | 0x01;
+        p[1] = ts >> 22;
+        p[2] = ((ts >> 14) & 0xfe) | 0x01;
+        p[3] = ts >> 7;
+        p[4] = ((ts << 1) & 0xfe) | 0x01;
+    }
+
+    /** @brief shift PTS and DTS of a PES header starting in this packet */
+    void rewritePes(uint8_t* tsPacket) {
+        size_t payload = TS_HEADER_SIZE + (ts_has_adaptation(tsPacket) ? 1 + ts_get_adaptation(tsPacket) : 0);
+        // the fixed part of the header, up to the header data length
+        if (payload + 9 > TS_SIZE) {
+            return;
+        }
+        uint8_t* pes = tsPacket + payload;
+        if (pes[0] != 0 || pes[1] != 0 || pes[2] != 1 || (pes[6] & 0xc0) != 0x80) {
+            return;
+        }
+
+        // the PTS needs 14 bytes of header, PTS and DTS 19
+        uint64_t offset = m_offset / 300;
+        if ((pes[7] & 0x80) && payload + 14 <= TS_SIZE) {
+            setTimestamp(pes + 9, (getTimestamp(pes + 9) + offset) % TS_LOOP_PTS_WRAP);
+        }
+        if ((pes[7] & 0xc0) == 0xc0 && payload + 19 <= TS_SIZE) {
+            setTimestamp(pes + 14, (getTimestamp(pes + 14) + offset) % TS_LOOP_PTS_WRAP);
+        }
+    }
+
+    /** @brief continue the continuity counter of the pid, where the last pass stopped */
+    void rewriteCc(uint8_t* tsPacket, int pid) {
+        bool payload = ts_has_payload(tsPacket);
+        int cc = ts_get_cc(tsPacket);
+
+        if (!m_seen[pid]) {
+            m_seen[pid] = true;
+            if (m_lastCc[pid] >= 0) {
+                // without payload the counter doesn't count
+                m_ccDelta[pid] = (m_lastCc[pid] + (payload ? 1 : 0) - cc) & 0x0f;
+            }
+        }
+
+        cc = (cc + m_ccDelta[pid]) & 0x0f;
+        tsPacket[3] = (tsPacket[3] & 0xf0) | cc;
+        m_lastCc[pid] = cc;
+    }
+
+    std::vector<int> m_lastCc;    /** last written cc per pid, -1 if the pid didn't occur yet */
+    std::vector<int> m_ccDelta;   /** added to the cc of the file, per pid */
+    std::vector<bool> m_seen;     /** pid occurred in this pass */
+    uint64_t m_offset = 0;        /** added to all PCRs, in 27MHz ticks */
+    unsigned long m_loops = 0;
+    int m_pcrPid = -1;
+    uint64_t m_pcrCount = 0;
+    uint64_t m_lastPcr = 0;
+    uint64_t m_pcrSpan = 0;       /** sum of the PCR intervals in the first pass */
+};
+
+#undef TS_LOOP_PIDS
+#undef TS_LOOP_PTS_WRAP
+#endif /* INPUT_TSLOOPREWRITER_H_ */
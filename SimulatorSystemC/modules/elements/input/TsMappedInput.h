@@ -0,0 +1,78 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file TsInput reading from a memory mapped file.
+ *
+ * Taken packets are views into the mapping. Nothing is copied or allocated per packet. A consumer writing to
+ * a packet only changes its private copy of the page, see MappedFile.h.
+ */
+
+#ifndef INPUT_TSMAPPEDINPUT_H_
+#define INPUT_TSMAPPEDINPUT_H_
+
+#include <modules/elements/input/TsInput.h>
+#include <modules/elements/input/MappedFile.h>
+#include <algorithm>
+
+class TsMappedInput : public TsInput {
+public:
+    bool open(const std::string& filename, uint64_t offset = 0) {
+        m_pos = 0;
+        if (!m_file.open(filename, true)) {
+            return false;
+        }
+        m_pos = std::min((size_t)offset, m_file.size());
+        return true;
+    }
+
+    size_t peek(const uint8_t*& data, size_t size) {
+        data = m_file.data() + m_pos;
+        return std::min(size, m_file.size() - m_pos);
+    }
+
+    void skip(size_t size) {
+        m_pos = std::min(m_pos + size, m_file.size());
+    }
+
+    /** @brief the returned packet points into the mapping.
+     */
+    uint8_t* take(size_t size) {
+        if (m_file.size() - m_pos < size) {
+            return NULL;
+        }
+        uint8_t* packet = m_file.data() + m_pos;
+        m_pos += size;
+        return packet;
+    }
+
+    /** @brief nothing to do, the packets belong to the mapping.
+     */
+    void release(uint8_t*) {
+    }
+
+private:
+    MappedFile m_file;
+    size_t m_pos = 0;
+};
+
+#endif /* INPUT_TSMAPPEDINPUT_H_ */
@@ -0,0 +1,117 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file the packet formats a transport stream file could be stored in.
+ *
+ * The readers and the demux are templates on these layouts, so packet size and header offset are compile
+ * time constants in the inner loops. The format is chosen once at runtime with "packetFormat":
+ *     "ts"    188 byte transport stream packets (default)
+ *     "m2ts"  192 byte M2TS/BDAV packets, with a 4 byte arrival timestamp in front of each TS packet
+ *     "ts204" 204 byte packets, with 16 byte Reed Solomon parity behind each TS packet
+ */
+
+#ifndef INPUT_TSPACKETFORMAT_H_
+#define INPUT_TSPACKETFORMAT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/** @brief layout of one packet in the file
+ *
+ * @tparam PacketSize distance between two packets in the file
+ * @tparam HeaderOffset offset of the TS header (the sync byte) inside the packet
+ */
+template<size_t PacketSize, size_t HeaderOffset>
+struct TsPacketLayout {
+    static constexpr size_t packetSize = PacketSize;
+    static constexpr size_t headerOffset = HeaderOffset;
+};
+
+template<size_t PacketSize, size_t HeaderOffset>
+constexpr size_t TsPacketLayout<PacketSize, HeaderOffset>::packetSize;
+template<size_t PacketSize, size_t HeaderOffset>
+constexpr size_t TsPacketLayout<PacketSize, HeaderOffset>::headerOffset;
+
+typedef TsPacketLayout<188, 0> TsFormatTs;
+typedef TsPacketLayout<192, 4> TsFormatM2ts;
+typedef TsPacketLayout<204, 0> TsFormatTs204;
+
+#define TS_PACKET_FORMAT_MAX_SIZE 204 /** largest packet size of all formats */
+
+enum TsPacketFormat {
+    TS_PACKET_FORMAT_TS,
+    TS_PACKET_FORMAT_M2TS,
+    TS_PACKET_FORMAT_TS204
+};
+
+/** @brief get the format for a "packetFormat" config string
+ *
+ * @param[in] name "ts", "m2ts" or "ts204"
+ * @param[out] format the format
+ *
+ * @return false if the name is unknown
+ */
+inline bool tsPacketFormatFromString(const std::string& name, TsPacketFormat& format)
+{
+    if (name == "ts") {
+        format = TS_PACKET_FORMAT_TS;
+    } else if (name == "m2ts") {
+        format = TS_PACKET_FORMAT_M2TS;
+    } else if (name == "ts204") {
+        format = TS_PACKET_FORMAT_TS204;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/** @brief get the size of a packet at runtime
+ */
+inline size_t tsPacketFormatSize(TsPacketFormat format)
+{
+    switch (format) {
+        case TS_PACKET_FORMAT_M2TS:
+            return TsFormatM2ts::packetSize;
+        case TS_PACKET_FORMAT_TS204:
+            return TsFormatTs204::packetSize;
+        default:
+            return TsFormatTs::packetSize;
+    }
+}
+
+/** @brief get the offset of the TS header inside a packet at runtime
+ */
+inline size_t tsPacketFormatHeaderOffset(TsPacketFormat format)
+{
+    switch (format) {
+        case TS_PACKET_FORMAT_M2TS:
+            return TsFormatM2ts::headerOffset;
+        case TS_PACKET_FORMAT_TS204:
+            return TsFormatTs204::headerOffset;
+        default:
+            return TsFormatTs::headerOffset;
+    }
+}
+
+#endif /* INPUT_TSPACKETFORMAT_H_ */
@@ -0,0 +1,167 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file index of the PCRs of a transport stream file, used to pace VBR streams.
+ *
+ * The file is scanned once for PCRs on one PID. The packets between two PCRs arrive with the rate given
+ * by the two PCRs (piecewise linear interpolation), so each of these intervals can be sent as one burst,
+ * followed by one wait. Spread over the interval, a packet at offset o of [begin, end) is sent
+ * (o - begin) / (end - begin) * duration after the first PCR.
+ */
+
+#ifndef INPUT_TSPCRINDEX_H_
+#define INPUT_TSPCRINDEX_H_
+
+#include <modules/elements/input/MappedFile.h>
+#include <modules/elements/input/TsPcr.h>
+#include <modules/elements/input/TsSync.h>
+#include "mpeg/ts.h"
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+
+class TsPcrIndex {
+public:
+    /** @brief scan a file for PCRs
+     *
+     * @param filename the TS file
+     * @param packetSize size of a packet in the file
+     * @param headerOffset offset of the TS header inside a packet
+     * @param pcrPid pid carrying the PCR
+     * @param lockCount amount of consecutive sync bytes needed, if the sync got lost
+     *
+     * @return false if the file could not be mapped
+     */
+    bool build(const std::string& filename, size_t packetSize, size_t headerOffset, int pcrPid, int lockCount) {
+        MappedFile file;
+        m_intervals.clear();
+
+        if (!file.open(filename, true)) {
+            return false;
+        }
+
+        const uint8_t* data = file.data();
+        size_t size = file.size();
+        size_t pos = 0;
+        bool hasLast = false;
+        uint64_t lastOffset = 0;
+        uint64_t lastPcr = 0;
+
+        while (pos + packetSize <= size) {
+            const uint8_t* tsPacket = data + pos + headerOffset;
+
+            if (!ts_validate(tsPacket)) {
+                bool locked;
+                pos += std::max((size_t)1, tsFindSync(data + pos, size - pos, packetSize, lockCount, headerOffset, locked));
+                continue;
+            }
+
+            if (ts_get_pid(tsPacket) == pcrPid && ts_has_adaptation(tsPacket) && (ts_get_adaptation(tsPacket) != 0)
+                && tsaf_has_pcr(tsPacket)) {
+                uint64_t pcr = tsaf_get_pcr(tsPacket) * 300 + tsaf_get_pcrext(tsPacket);
+
+                if (hasLast) {
+                    // the PCR counts modulo TsPcr::wrap
+                    uint64_t delta = (pcr + TsPcr::wrap - lastPcr) % TsPcr::wrap;
+                    Interval interval;
+                    interval.begin = lastOffset;
+                    interval.end = pos;
+                    interval.duration = 0;
+                    if (!tsaf_has_discontinuity(tsPacket) && delta > 0 && delta <= TsPcr::maxGap) {
+                        interval.duration = delta / 27e6;
+                    }
+                    m_intervals.push_back(interval);
+                }
+                hasLast = true;
+                lastOffset = pos;
+                lastPcr = pcr;
+            }
+            pos += packetSize;
+        }
+        return true;
+    }
+
+    /** @brief amount of PCR intervals found
+     */
+    size_t size() const {
+        return m_intervals.size();
+    }
+
+    /** @brief look up the PCR interval, a packet belongs to.
+     *
+     * @param[in] offset byte offset of the packet in the file
+     * @param[out] end byte offset of the next PCR packet
+     * @param[out] duration time between the two PCRs in seconds
+     *
+     * @return false if the packet is not between two valid PCRs (before the first or after the last PCR, or at a discontinuity)
+     */
+    bool interval(uint64_t offset, uint64_t& end, double& duration) const {
+        uint64_t begin;
+        return interval(offset, begin, end, duration);
+    }
+
+    /** @brief look up the PCR interval, a packet belongs to, see above.
+     *
+     * @param[out] begin byte offset of the PCR packet starting the interval
+     */
+    bool interval(uint64_t offset, uint64_t& begin, uint64_t& end, double& duration) const {
+        std::vector<Interval>::const_iterator it = std::upper_bound(m_intervals.begin(), m_intervals.end(), offset,
+            [](uint64_t value, const Interval& interval) { return value < interval.end; });
+
+        if (it == m_intervals.end() || offset < it->begin || it->duration <= 0) {
+            return false;
+        }
+        begin = it->begin;
+        end = it->end;
+        duration = it->duration;
+        return true;
+    }
+
+    /** @brief mean transfer time of one byte, over all valid intervals.
+     *
+     * @return seconds per byte, 0 if there is no valid interval
+     */
+    double secondsPerByte() const {
+        double duration = 0;
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < m_intervals.size(); i++) {
+            if (m_intervals[i].duration > 0) {
+                duration += m_intervals[i].duration;
+                bytes += m_intervals[i].end - m_intervals[i].begin;
+            }
+        }
+        return bytes ? duration / bytes : 0;
+    }
+
+private:
+    /** @brief packets starting in [begin, end) are sent within duration seconds. */
+    struct Interval {
+        uint64_t begin;
+        uint64_t end;
+        double duration; /** 0 if there is a discontinuity between the two PCRs */
+    };
+
+    std::vector<Interval> m_intervals;
+};
+
+#endif /* INPUT_TSPCRINDEX_H_ */
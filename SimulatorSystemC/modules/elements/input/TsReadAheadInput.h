@@ -0,0 +1,325 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file TsInput with a host thread, that reads the file ahead of the simulation.
+ *
+ * The file is read in large chunks by a separate thread into a lock free ring. The SystemC thread only
+ * takes ready chunks out of the ring, so slow file systems (e.g. NFS) don't stall the simulation kernel
+ * on every read. It only blocks (on a condition variable) when the read ahead thread is behind.
+ *
+ * Taken packets are views into the chunks, nothing is copied per packet. A chunk leaves the ring when the
+ * SystemC thread starts on it, and stays alive until all packets taken out of it are released. The few bytes
+ * of a packet, that is split between two chunks, are copied in front of the next chunk.
+ */
+
+#ifndef INPUT_TSREADAHEADINPUT_H_
+#define INPUT_TSREADAHEADINPUT_H_
+
+#include <modules/elements/input/TsInput.h>
+#include <modules/elements/input/TsSync.h>
+#include "framework/SpscRing.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define TS_READ_AHEAD_CHUNK_SIZE (1024 * 1024) //1MB
+#define TS_READ_AHEAD_CHUNKS 16
+#define TS_READ_AHEAD_HEADROOM TS_SYNC_BLOCK_SIZE // room for the rest of the previous chunk
+
+class TsReadAheadInput : public TsInput {
+public:
+    TsReadAheadInput():
+        m_ring(TS_READ_AHEAD_CHUNKS)
+    {
+        // give every slot of the ring its chunk memory, so the read ahead thread never allocates
+        for (size_t i = 0; i < m_ring.capacity(); i++) {
+            m_spare.push_back(newData());
+        }
+        for (size_t i = 0; i < m_ring.capacity(); i++) {
+            Chunk* chunk = m_ring.producerSlot();
+            chunk->data.swap(m_spare.back());
+            m_spare.pop_back();
+            m_ring.publish();
+            m_ring.consume();
+        }
+    };
+
+    ~TsReadAheadInput() {
+        stop();
+        if (m_account) {
+            m_account->free(m_bytes);
+        }
+    }
+
+    bool open(const std::string& filename, uint64_t offset = 0) {
+        stop();
+        retire();
+
+        m_fd = ::open(filename.c_str(), O_RDONLY);
+        if (m_fd < 0) {
+            return false;
+        }
+        if (offset > 0 && lseek(m_fd, offset, SEEK_SET) < 0) {
+            ::close(m_fd);
+            m_fd = -1;
+            return false;
+        }
+        posix_fadvise(m_fd, offset, 0, POSIX_FADV_SEQUENTIAL);
+
+        m_stop = false;
+        m_eof = false;
+        m_thread = std::thread(&TsReadAheadInput::prefetch, this);
+        return true;
+    }
+
+    size_t peek(const uint8_t*& data, size_t size) {
+        if (m_end - m_pos < size) {
+            nextChunk(size);
+        }
+        data = current() + m_pos;
+        return std::min(size, m_end - m_pos);
+    }
+
+    void skip(size_t size) {
+        while (size > 0) {
+            const uint8_t* data;
+            size_t available = peek(data, std::min(size, (size_t)TS_READ_AHEAD_CHUNK_SIZE));
+            if (available == 0) {
+                return;
+            }
+            m_pos += available;
+            size -= available;
+        }
+    }
+
+    /** @brief the returned packet points into the current chunk.
+     */
+    uint8_t* take(size_t size) {
+        const uint8_t* data;
+        if (peek(data, size) < size) {
+            return NULL;
+        }
+        uint8_t* packet = current() + m_pos;
+        m_pos += size;
+        m_blocks.back().taken++;
+        return packet;
+    }
+
+    /** @brief the chunk of the packet is reused, when its last packet is released.
+     */
+    void release(uint8_t* packet) {
+        for (std::list<Block>::iterator it = m_blocks.begin(); it != m_blocks.end(); ++it) {
+            if (packet >= it->data.data() && packet < it->data.data() + it->data.size()) {
+                it->taken--;
+                if (it->taken == 0 && std::next(it) != m_blocks.end()) {
+                    m_spare.push_back(std::vector<uint8_t>());
+                    m_spare.back().swap(it->data);
+                    m_blocks.erase(it);
+                }
+                return;
+            }
+        }
+    }
+
+    void setAccount(const std::shared_ptr<AllocationAccount>& account) {
+        m_account = account;
+        m_account->allocate(m_bytes);
+    }
+
+private:
+    struct Chunk {
+        std::vector<uint8_t> data;
+        size_t size = 0;
+    };
+
+    /** @brief a chunk taken out of the ring by the SystemC thread
+     */
+    struct Block {
+        std::vector<uint8_t> data;
+        int taken = 0; // packets not released yet
+    };
+
+    uint8_t* current() {
+        return m_blocks.empty() ? NULL : m_blocks.back().data.data();
+    }
+
+    std::vector<uint8_t> newData() {
+        m_bytes += TS_READ_AHEAD_HEADROOM + TS_READ_AHEAD_CHUNK_SIZE;
+        if (m_account) {
+            m_account->allocate(TS_READ_AHEAD_HEADROOM + TS_READ_AHEAD_CHUNK_SIZE);
+        }
+        return std::vector<uint8_t>(TS_READ_AHEAD_HEADROOM + TS_READ_AHEAD_CHUNK_SIZE);
+    }
+
+    /** @brief continue with the next chunks of the ring, till size bytes are available or the file ends.
+     *
+     * Blocks on the condition variable, if the read ahead thread is behind.
+     */
+    void nextChunk(size_t size) {
+        while (m_end - m_pos < size) {
+            Chunk* chunk;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_dataCond.wait(lock, [this, &chunk] {
+                    chunk = m_ring.consumerSlot();
+                    return chunk != NULL || m_eof.load(std::memory_order_acquire) || m_fd < 0;
+                });
+            }
+            if (chunk == NULL) {
+                return;
+            }
+
+            // take the chunk out of the ring, the ring gets a spare one back
+            Block block;
+            block.data.swap(chunk->data);
+            size_t chunkSize = chunk->size;
+            if (m_spare.empty()) {
+                m_spare.push_back(newData());
+            }
+            chunk->data.swap(m_spare.back());
+            m_spare.pop_back();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_ring.consume();
+            }
+            m_spaceCond.notify_one();
+
+            // the rest of the current chunk goes in front of the new one
+            size_t rest = m_end - m_pos;
+            size_t start = TS_READ_AHEAD_HEADROOM;
+            size_t end = TS_READ_AHEAD_HEADROOM + chunkSize;
+            if (rest <= TS_READ_AHEAD_HEADROOM) {
+                start -= rest;
+                memcpy(block.data.data() + start, current() + m_pos, rest);
+            } else {
+                block.data.insert(block.data.begin() + TS_READ_AHEAD_HEADROOM, current() + m_pos, current() + m_end);
+                end += rest;
+            }
+            retire();
+            m_blocks.push_back(std::move(block));
+            m_pos = start;
+            m_end = end;
+        }
+    }
+
+    /** @brief give up the current chunk. It is reused right away, if none of its packets is taken.
+     */
+    void retire() {
+        if (!m_blocks.empty() && m_blocks.back().taken == 0) {
+            m_spare.push_back(std::vector<uint8_t>());
+            m_spare.back().swap(m_blocks.back().data);
+            m_blocks.pop_back();
+        }
+        m_pos = 0;
+        m_end = 0;
+    }
+
+    /** @brief runs in the read ahead thread, fills the ring until the end of the file.
+     */
+    void prefetch() {
+        while (true) {
+            Chunk* chunk;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_spaceCond.wait(lock, [this, &chunk] {
+                    chunk = m_ring.producerSlot();
+                    return chunk != NULL || m_stop.load(std::memory_order_relaxed);
+                });
+            }
+            if (m_stop.load(std::memory_order_relaxed)) {
+                break;
+            }
+
+            ssize_t read = ::read(m_fd, chunk->data.data() + TS_READ_AHEAD_HEADROOM, TS_READ_AHEAD_CHUNK_SIZE);
+            if (read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (read <= 0) {
+                break;
+            }
+
+            chunk->size = read;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_ring.publish();
+            }
+            m_dataCond.notify_one();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_eof.store(true, std::memory_order_release);
+        }
+        m_dataCond.notify_one();
+    }
+
+    /** @brief stop the read ahead thread, and drop everything that is still in the ring.
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_spaceCond.notify_one();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        while (m_ring.consumerSlot() != NULL) {
+            m_ring.consume();
+        }
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    SpscRing<Chunk> m_ring;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_dataCond;  // a chunk was published, or the file ended
+    std::condition_variable m_spaceCond; // a slot was given back, or the thread shall stop
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_eof{false};
+    int m_fd = -1;
+
+    // only used by the SystemC thread
+    std::list<Block> m_blocks;              // the current chunk at the back, before it the ones with taken packets
+    std::vector<std::vector<uint8_t> > m_spare; // chunk memory to give back to the ring
+    size_t m_pos = 0;
+    size_t m_end = 0;
+    size_t m_bytes = 0;
+    std::shared_ptr<AllocationAccount> m_account;
+};
+
+#undef TS_READ_AHEAD_CHUNK_SIZE
+#undef TS_READ_AHEAD_CHUNKS
+#undef TS_READ_AHEAD_HEADROOM
+#endif /* INPUT_TSREADAHEADINPUT_H_ */
@@ -0,0 +1,435 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file remuxes several single program transport stream files into one multi program transport stream, in memory.
+ *
+ * Every source file is mapped, its PAT and PMT are parsed, and its PCRs are indexed. The pids of source i
+ * are moved into the block 0x100 + 16 * i:
+ *     0x100 + 16 * i          PMT
+ *     0x101 + 16 * i + k      k-th elementary stream of the PMT (up to 14)
+ *     0x10f + 16 * i          PCR, if it is not carried by an elementary stream
+ * All other pids of the sources (PAT, SI tables, null packets) are dropped. The program number of source i
+ * is i + 1. A new PAT and the rewritten PMTs are inserted every psiInterval.
+ *
+ * Each packet gets the arrival time of its source, interpolated between the PCRs of the source like
+ * TsPcrIndex does for pacing, and the packets of all sources are interleaved in the order of these times.
+ */
+
+#ifndef INPUT_TSREMUXER_H_
+#define INPUT_TSREMUXER_H_
+
+#include <modules/elements/input/MappedFile.h>
+#include <modules/elements/input/TsCrc32.h>
+#include <modules/elements/input/TsPcrIndex.h>
+#include <modules/elements/input/TsSync.h>
+#include "mpeg/ts.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#define TS_REMUX_PIDS 8192
+#define TS_REMUX_PAT_PID 0
+#define TS_REMUX_PID_BASE 0x100
+#define TS_REMUX_PID_BLOCK 16
+#define TS_REMUX_MAX_STREAMS 14
+#define TS_REMUX_MAX_SOURCES ((0x1fff - TS_REMUX_PID_BASE) / TS_REMUX_PID_BLOCK)
+
+class TsRemuxer {
+    typedef std::array<uint8_t, TS_SIZE> PsiPacket;
+
+public:
+    TsRemuxer():
+        m_psiCc(TS_REMUX_PIDS, 0)
+    {
+    };
+
+    /** @brief time between two PAT/PMT insertions, in seconds */
+    void setPsiInterval(double psiInterval) {
+        m_psiInterval = psiInterval;
+    }
+
+    /** @brief amount of sources not at their end */
+    int activeSources() const {
+        int active = 0;
+        for (size_t i = 0; i < m_sources.size(); i++) {
+            active += m_sources[i]->done ? 0 : 1;
+        }
+        return active;
+    }
+
+    /** @brief add a single program transport stream file, as next program.
+     *
+     * @param[in] filename the TS file
+     * @param[in] packetSize size of a packet in the file
+     * @param[in] headerOffset offset of the TS header inside a packet
+     * @param[in] lockCount amount of consecutive sync bytes needed, if the sync got lost
+     * @param[out] error reason, if the file can't be used
+     *
+     * @return false if the file can't be used
+     */
+    bool addSource(const std::string& filename, size_t packetSize, size_t headerOffset, int lockCount, std::string& error) {
+        if (m_sources.size() >= TS_REMUX_MAX_SOURCES) {
+            error = "too many sources";
+            return false;
+        }
+
+        std::unique_ptr<Source> source(new Source());
+        source->packetSize = packetSize;
+        source->headerOffset = headerOffset;
+        source->lockCount = lockCount;
+        source->programNumber = m_sources.size() + 1;
+        source->pidMap.assign(TS_REMUX_PIDS, -1);
+
+        if (!source->file.open(filename, true)) {
+            error = "could not map the file";
+            return false;
+        }
+        // skip leading garbage, like every later packet
+        source->pos = findPacket(*source, 0);
+        source->done = (source->pos >= source->file.size());
+
+        std::vector<uint8_t> section;
+        if (!readSection(*source, TS_REMUX_PAT_PID, 0x00, section)) {
+            error = "no valid PAT found";
+            return false;
+        }
+        int pmtPid = -1;
+        for (size_t pos = 8; pos + 4 <= section.size() - 4; pos += 4) {
+            int programNumber = (section[pos] << 8) | section[pos + 1];
+            if (programNumber != 0) {
+                pmtPid = ((section[pos + 2] & 0x1f) << 8) | section[pos + 3];
+                break;
+            }
+        }
+        if (pmtPid < 0 || !readSection(*source, pmtPid, 0x02, section)) {
+            error = "no valid PMT found";
+            return false;
+        }
+
+        int pcrPid = ((section[8] & 0x1f) << 8) | section[9];
+        if (!source->pcrIndex.build(filename, packetSize, headerOffset, pcrPid, lockCount)
+            || source->pcrIndex.secondsPerByte() <= 0) {
+            error = "no PCRs found on the PCR pid";
+            return false;
+        }
+        source->secondsPerByte = source->pcrIndex.secondsPerByte();
+
+        buildPmt(*source, section, pmtPid, pcrPid);
+        m_sources.push_back(std::move(source));
+        buildPat();
+        return true;
+    }
+
+    /** @brief get the next packet of the multiplex.
+     *
+     * @param[out] packet TS_SIZE bytes
+     * @param[out] time arrival time of the packet in seconds, never decreasing
+     *
+     * @return false if all sources are at their end
+     */
+    bool next(uint8_t* packet, double& time) {
+        while (true) {
+            Source* source = NULL;
+            for (size_t i = 0; i < m_sources.size(); i++) {
+                Source* candidate = m_sources[i].get();
+                if (!candidate->done && (!source || candidate->time < source->time)) {
+                    source = candidate;
+                }
+            }
+            if (!source) {
+                return false;
+            }
+
+            time = std::max(source->time, m_time);
+            if (m_psiPending == 0 && time >= m_nextPsi) {
+                m_psiPending = m_psi.size();
+                m_nextPsi = time + m_psiInterval;
+            }
+            if (m_psiPending > 0) {
+                writePsi(packet, m_psi[m_psi.size() - m_psiPending]);
+                m_psiPending--;
+                m_time = time;
+                return true;
+            }
+
+            const uint8_t* tsPacket = source->file.data() + source->pos + source->headerOffset;
+            int pid = source->pidMap[ts_get_pid(tsPacket)];
+            if (pid >= 0) {
+                memcpy(packet, tsPacket, TS_SIZE);
+                packet[1] = (packet[1] & 0xe0) | ((pid >> 8) & 0x1f);
+                packet[2] = pid & 0xff;
+            }
+            step(*source);
+
+            if (pid >= 0) {
+                m_time = time;
+                return true;
+            }
+        }
+    }
+
+private:
+    struct Source {
+        MappedFile file;
+        TsPcrIndex pcrIndex;
+        size_t packetSize;
+        size_t headerOffset;
+        int lockCount;
+        int programNumber;
+        int pmtPid;
+        int pcrPid;                 /** pid of the PCR after remapping */
+        std::vector<int> pidMap;    /** new pid for every pid of the file, -1 to drop it */
+        std::vector<uint8_t> pmt;   /** the rewritten PMT section */
+        size_t pos = 0;             /** offset of the next packet */
+        double time = 0;            /** arrival time of the next packet */
+        uint64_t intervalEnd = 0;   /** end of the PCR interval of the cached rate */
+        double intervalSecondsPerByte = 0;
+        double secondsPerByte = 0;  /** mean rate, outside of the PCR intervals */
+        bool done = false;
+    };
+
+    /** @brief offset of the first valid packet at or behind pos, or the file size */
+    static size_t findPacket(const Source& source, size_t pos) {
+        const uint8_t* data = source.file.data();
+        size_t size = source.file.size();
+        while (pos + source.packetSize <= size && !ts_validate(data + pos + source.headerOffset)) {
+            bool locked;
+            pos += std::max((size_t)1, tsFindSync(data + pos, size - pos, source.packetSize, source.lockCount, source.headerOffset, locked));
+        }
+        return (pos + source.packetSize <= size) ? pos : size;
+    }
+
+    /** @brief move a source to its next packet, and increase its time by the transfer time of the bytes passed */
+    void step(Source& source) {
+        size_t pos = findPacket(source, source.pos + source.packetSize);
+
+        if (source.pos >= source.intervalEnd) {
+            uint64_t begin, end;
+            double duration;
+            if (source.pcrIndex.interval(source.pos, begin, end, duration)) {
+                source.intervalEnd = end;
+                source.intervalSecondsPerByte = duration / (end - begin);
+            } else {
+                source.intervalEnd = source.pos + source.packetSize;
+                source.intervalSecondsPerByte = source.secondsPerByte;
+            }
+        }
+
+        source.time += (pos - source.pos) * source.intervalSecondsPerByte;
+        source.pos = pos;
+        source.done = (pos >= source.file.size());
+    }
+
+    /** @brief read the first valid section of a table out of a source.
+     *
+     * @param[in] source the source, its file has to be mapped
+     * @param[in] pid pid carrying the table
+     * @param[in] tableId table id of the section
+     * @param[out] section the section, including CRC
+     *
+     * @return false if there is no valid section in the file
+     */
+    bool readSection(const Source& source, int pid, int tableId, std::vector<uint8_t>& section) {
+        size_t length = 0;
+        section.clear();
+
+        for (size_t pos = findPacket(source, 0); pos < source.file.size(); pos = findPacket(source, pos + source.packetSize)) {
+            uint8_t* tsPacket = (uint8_t*)source.file.data() + pos + source.headerOffset;
+            if (ts_get_pid(tsPacket) != pid || !ts_has_payload(tsPacket)) {
+                continue;
+            }
+            uint8_t* payload = ts_payload(tsPacket);
+            uint8_t* end = tsPacket + TS_SIZE;
+            if (payload >= end) {
+                continue;
+            }
+
+            if (ts_get_unitstart(tsPacket)) {
+                payload += 1 + payload[0]; // pointer field
+                if (payload + 3 > end || payload[0] != tableId) {
+                    section.clear();
+                    continue;
+                }
+                length = (((payload[1] & 0x0f) << 8) | payload[2]) + 3;
+                section.assign(payload, std::min(end, payload + length));
+            } else if (!section.empty()) {
+                section.insert(section.end(), payload, std::min(end, payload + (length - section.size())));
+            }
+
+            if (!section.empty() && section.size() == length) {
+                if (length >= 12 && tsCrc32(section.data(), length) == 0) {
+                    return true;
+                }
+                section.clear();
+            }
+        }
+        return false;
+    }
+
+    /** @brief start a section: table id, and the header of the long section syntax */
+    static void sectionHeader(std::vector<uint8_t>& section, int tableId, int extension) {
+        section.clear();
+        section.push_back(tableId);
+        section.push_back(0xb0); // length, set by finishSection()
+        section.push_back(0x00);
+        section.push_back(extension >> 8);
+        section.push_back(extension & 0xff);
+        section.push_back(0xc1); // version 0, current
+        section.push_back(0x00); // section number
+        section.push_back(0x00); // last section number
+    }
+
+    /** @brief set the length and append the CRC */
+    static void finishSection(std::vector<uint8_t>& section) {
+        size_t length = section.size() - 3 + 4;
+        section[1] = 0xb0 | ((length >> 8) & 0x0f);
+        section[2] = length & 0xff;
+        uint32_t crc = tsCrc32(section.data(), section.size());
+        section.push_back(crc >> 24);
+        section.push_back(crc >> 16);
+        section.push_back(crc >> 8);
+        section.push_back(crc);
+    }
+
+    static void pushPid(std::vector<uint8_t>& section, int prefix, int pid) {
+        section.push_back(prefix | ((pid >> 8) & 0x1f));
+        section.push_back(pid & 0xff);
+    }
+
+    /** @brief assign the new pids of a source, and rewrite its PMT with them
+     *
+     * @param source the source
+     * @param pmt PMT section of the file
+     * @param pmtPid pid of the PMT in the file
+     * @param pcrPid pid of the PCR in the file
+     */
+    void buildPmt(Source& source, const std::vector<uint8_t>& pmt, int pmtPid, int pcrPid) {
+        int base = TS_REMUX_PID_BASE + TS_REMUX_PID_BLOCK * (source.programNumber - 1);
+        source.pmtPid = base;
+
+        size_t end = pmt.size() - 4;
+        size_t programInfo = ((pmt[10] & 0x0f) << 8) | pmt[11];
+        size_t pos = std::min(end, 12 + programInfo);
+        std::vector<uint8_t>& section = source.pmt;
+
+        sectionHeader(section, 0x02, source.programNumber);
+        section.push_back(0); // PCR pid, set below
+        section.push_back(0);
+        section.insert(section.end(), pmt.begin() + 10, pmt.begin() + pos);
+
+        int streams = 0;
+        while (pos + 5 <= end && streams < TS_REMUX_MAX_STREAMS) {
+            int pid = ((pmt[pos + 1] & 0x1f) << 8) | pmt[pos + 2];
+            size_t esInfo = ((pmt[pos + 3] & 0x0f) << 8) | pmt[pos + 4];
+            size_t next = std::min(end, pos + 5 + esInfo);
+
+            if (source.pidMap[pid] < 0) {
+                source.pidMap[pid] = base + 1 + streams;
+                streams++;
+            }
+            section.push_back(pmt[pos]);
+            pushPid(section, 0xe0, source.pidMap[pid]);
+            section.insert(section.end(), pmt.begin() + pos + 3, pmt.begin() + next);
+            pos = next;
+        }
+
+        if (source.pidMap[pcrPid] < 0 && pcrPid != 0x1fff) {
+            source.pidMap[pcrPid] = base + TS_REMUX_PID_BLOCK - 1;
+        }
+        source.pcrPid = (pcrPid == 0x1fff) ? 0x1fff : source.pidMap[pcrPid];
+        section[8] = 0xe0 | ((source.pcrPid >> 8) & 0x1f);
+        section[9] = source.pcrPid & 0xff;
+        finishSection(section);
+
+        // the file's own PMT is replaced by the rewritten one
+        source.pidMap[pmtPid] = -1;
+    }
+
+    /** @brief build the PAT of all sources, and the PSI packets to insert */
+    void buildPat() {
+        sectionHeader(m_pat, 0x00, 1);
+        for (size_t i = 0; i < m_sources.size(); i++) {
+            m_pat.push_back(m_sources[i]->programNumber >> 8);
+            m_pat.push_back(m_sources[i]->programNumber & 0xff);
+            pushPid(m_pat, 0xe0, m_sources[i]->pmtPid);
+        }
+        finishSection(m_pat);
+
+        m_psi.clear();
+        packetize(TS_REMUX_PAT_PID, m_pat);
+        for (size_t i = 0; i < m_sources.size(); i++) {
+            packetize(m_sources[i]->pmtPid, m_sources[i]->pmt);
+        }
+    }
+
+    /** @brief split a section into PSI packets, the continuity counter is set when they are sent */
+    void packetize(int pid, const std::vector<uint8_t>& section) {
+        size_t offset = 0;
+        while (offset < section.size()) {
+            PsiPacket psi;
+            uint8_t* packet = psi.data();
+            packet[0] = 0x47;
+            packet[1] = ((offset == 0) ? 0x40 : 0x00) | ((pid >> 8) & 0x1f);
+            packet[2] = pid & 0xff;
+            packet[3] = 0x10;
+
+            uint8_t* p = packet + TS_HEADER_SIZE;
+            if (offset == 0) {
+                *p++ = 0; // pointer field
+            }
+            size_t size = std::min((size_t)(packet + TS_SIZE - p), section.size() - offset);
+            memcpy(p, section.data() + offset, size);
+            memset(p + size, 0xff, packet + TS_SIZE - p - size);
+            offset += size;
+            m_psi.push_back(psi);
+        }
+    }
+
+    void writePsi(uint8_t* packet, const PsiPacket& psi) {
+        memcpy(packet, psi.data(), TS_SIZE);
+        int pid = ts_get_pid(packet);
+        packet[3] = (packet[3] & 0xf0) | m_psiCc[pid];
+        m_psiCc[pid] = (m_psiCc[pid] + 1) & 0x0f;
+    }
+
+    std::vector<std::unique_ptr<Source> > m_sources;
+    std::vector<uint8_t> m_pat;
+    std::vector<PsiPacket> m_psi;   /** PAT and PMTs, inserted every psiInterval */
+    std::vector<int> m_psiCc;       /** continuity counter of the inserted PSI, per pid */
+    size_t m_psiPending = 0;
+    double m_psiInterval = 0.1;
+    double m_nextPsi = 0;
+    double m_time = 0;
+};
+
+#undef TS_REMUX_PIDS
+#undef TS_REMUX_PAT_PID
+#undef TS_REMUX_PID_BASE
+#undef TS_REMUX_PID_BLOCK
+#undef TS_REMUX_MAX_STREAMS
+#undef TS_REMUX_MAX_SOURCES
+#endif /* INPUT_TSREMUXER_H_ */
@@ -0,0 +1,109 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file "startTime" and "preRoll" of the file input elements.
+ *
+ * With "startTime" (seconds since the first PCR) reading starts at the last random access point, at least
+ * "preRoll" seconds (0.5 by default) before. The positions are taken from the sidecar index, see TsIndex.h.
+ */
+
+#ifndef INPUT_TSSTARTTIME_H_
+#define INPUT_TSSTARTTIME_H_
+
+#include <modules/elements/input/TsIndex.h>
+#include <modules/elements/input/TsPacketFormat.h>
+#include "systemc.h"
+#include "rapidjson/document.h"
+#include <string>
+#include <stdint.h>
+
+class TsStartTime {
+public:
+    /** @brief read "startTime" and "preRoll" out of the configuration of an input element
+     *
+     * @param s the configuration of the element
+     * @param name name of the element
+     * @param moduleId id of the element for the reports
+     */
+    void loadConfig(rapidjson::Value& s, const char* name, const char* moduleId) {
+        parse(s, "startTime", this->startTime, name, moduleId);
+        parse(s, "preRoll", this->preRoll, name, moduleId);
+    }
+
+    /** @brief find the position in the file to start at. Uses (and builds) the sidecar index.
+     *
+     * @param filename the TS file
+     * @param format packet format of the file
+     * @param pcrPid pid carrying the PCR, or -1 to use the first pid with a PCR
+     * @param lockCount amount of consecutive sync bytes needed, if the sync got lost
+     * @param name name of the element
+     * @param moduleId id of the element for the reports
+     *
+     * @return byte position, 0 to start at the beginning
+     */
+    uint64_t findOffset(const std::string& filename, TsPacketFormat format, int pcrPid, int lockCount,
+                        const char* name, const char* moduleId) const {
+        if (this->startTime <= 0) {
+            return 0;
+        }
+
+        TsIndex index;
+        if (!index.open(filename, tsPacketFormatSize(format), tsPacketFormatHeaderOffset(format), pcrPid, lockCount)) {
+            SC_REPORT_WARNING(moduleId, "could not index the file, ignoring \"startTime\"");
+            return 0;
+        }
+
+        uint64_t offset = index.startOffset(this->startTime, this->preRoll);
+        std::string message;
+        message += "starting \"";
+        message += name;
+        message += "\" at byte ";
+        message += std::to_string(offset);
+        message += " for startTime ";
+        message += std::to_string(this->startTime);
+        SC_REPORT_INFO(moduleId, message.c_str());
+        return offset;
+    }
+
+    double startTime = 0;
+    double preRoll = 0.5;
+
+private:
+    void parse(rapidjson::Value& s, const char* key, double& value, const char* name, const char* moduleId) {
+        if (!s.HasMember(key)) {
+            return;
+        }
+        if (!s[key].IsNumber() || s[key].GetDouble() < 0) {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += name;
+            message += "\". \"";
+            message += key;
+            message += "\" is no positive Number";
+            SC_REPORT_FATAL(moduleId, message.c_str());
+        }
+        value = s[key].GetDouble();
+    }
+};
+
+#endif /* INPUT_TSSTARTTIME_H_ */
@@ -0,0 +1,60 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file TsInput reading the file with an ifstream.
+ *
+ * Every taken packet is a copy, that is deleted again on release.
+ */
+
+#ifndef INPUT_TSSTREAMINPUT_H_
+#define INPUT_TSSTREAMINPUT_H_
+
+#include <modules/elements/input/TsBufferedInput.h>
+#include <fstream>
+
+class TsStreamInput : public TsBufferedInput {
+protected:
+    bool openSource(const std::string& filename, uint64_t offset) {
+        // the file could still be open, from an earlier pass
+        m_file.close();
+        m_file.clear();
+        m_file.open(filename, std::ifstream::in | std::ifstream::binary);
+        if (m_file && offset > 0) {
+            m_file.seekg(offset);
+        }
+        return (bool)m_file;
+    }
+
+    size_t readSource(uint8_t* data, size_t size) {
+        if (!m_file) {
+            return 0;
+        }
+        m_file.read((char*)data, size);
+        return m_file.gcount();
+    }
+
+private:
+    std::ifstream m_file;
+};
+
+#endif /* INPUT_TSSTREAMINPUT_H_ */
@@ -0,0 +1,122 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file functions to find the transport stream sync again, after it got lost.
+ *
+ * Instead of trying every byte offset with a new read, a whole block is scanned for the sync byte with
+ * memchr (which is vectorized in the C library), and every candidate is only accepted, if the following
+ * packets start with a sync byte as well.
+ */
+
+#ifndef INPUT_TSSYNC_H_
+#define INPUT_TSSYNC_H_
+
+#include <modules/elements/input/TsInput.h>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include <stddef.h>
+
+#define TS_SYNC_BYTE 0x47
+#define TS_SYNC_BLOCK_SIZE (64 * 1024)
+#define TS_SYNC_LOCK_COUNT 5 /** default amount of consecutive packets to confirm a sync */
+
+/** @brief search a block for the first offset, where lockCount consecutive packets start with a sync byte.
+ *
+ * @param[in] data block to search
+ * @param[in] size size of the block
+ * @param[in] packetSize distance between two sync bytes
+ * @param[in] lockCount amount of consecutive sync bytes needed
+ * @param[in] syncOffset offset of the sync byte inside a packet
+ * @param[out] locked true if all lockCount sync bytes were found. false if the block ended before a
+ *             candidate could be confirmed, or if there was no candidate at all.
+ *
+ * @return offset of the packet with the (possibly unconfirmed) sync, or size if there was no candidate.
+ */
+inline size_t tsFindSync(const uint8_t* data, size_t size, size_t packetSize, int lockCount, size_t syncOffset, bool& locked)
+{
+    if (size <= syncOffset) {
+        locked = false;
+        return size;
+    }
+
+    const uint8_t* end = data + size;
+    const uint8_t* candidate = data + syncOffset;
+
+    while ((candidate = (const uint8_t*)memchr(candidate, TS_SYNC_BYTE, end - candidate)) != NULL) {
+        int found = 1;
+        while (found < lockCount
+               && (size_t)(end - candidate) > found * packetSize
+               && candidate[found * packetSize] == TS_SYNC_BYTE) {
+            found++;
+        }
+
+        if (found == lockCount) {
+            locked = true;
+            return candidate - data - syncOffset;
+        }
+        if ((size_t)(end - candidate) <= found * packetSize) {
+            // the block ends before the candidate could be confirmed
+            locked = false;
+            return candidate - data - syncOffset;
+        }
+        candidate++;
+    }
+
+    locked = false;
+    return size - syncOffset;
+}
+
+/** @brief step over the input, till lockCount consecutive packets start with a sync byte.
+ *
+ * Near the end of the input a sync is accepted, if all remaining packets start with a sync byte.
+ *
+ * @param input input to resync. After the call it is positioned at the sync byte, or at the end.
+ * @param packetSize distance between two sync bytes
+ * @param lockCount amount of consecutive sync bytes needed
+ * @param syncOffset offset of the sync byte inside a packet
+ *
+ * @return amount of bytes skipped
+ */
+inline size_t tsResync(TsInput& input, size_t packetSize, int lockCount, size_t syncOffset = 0)
+{
+    size_t blockSize = std::max((size_t)TS_SYNC_BLOCK_SIZE, packetSize * lockCount);
+    size_t skipped = 0;
+
+    while (true) {
+        const uint8_t* data;
+        bool locked;
+        size_t available = input.peek(data, blockSize);
+        size_t offset = tsFindSync(data, available, packetSize, lockCount, syncOffset, locked);
+
+        input.skip(offset);
+        skipped += offset;
+
+        if (locked || available < blockSize) {
+            return skipped;
+        }
+        // the next block starts at the unconfirmed candidate, or behind the searched block
+    }
+}
+
+#endif /* INPUT_TSSYNC_H_ */
@@ -0,0 +1,368 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file synthesizes a valid single program transport stream in memory.
+ *
+ * The stream has a PAT and a PMT, PCRs in own packets on the PCR pid, one video PES per frame and audio PES
+ * with a constant size. The video frame sizes follow a GOP structure: every GOP starts with an I frame
+ * (marked as random access point), that is "iFrameRatio" times larger than the other frames. GOP lengths
+ * are drawn uniformly between gopSize and gopSizeMax, and frame sizes vary normally with sizeDeviation.
+ *
+ * The packets are multiplexed with a constant mux rate: PSI and PCR when due, then audio, then video, and
+ * null packets when nothing is pending. The payload bytes are filler, so only the structure is valid, not
+ * the elementary streams. A packet costs a header write and one memcpy, no allocation.
+ */
+
+#ifndef INPUT_TSSYNTHESIZER_H_
+#define INPUT_TSSYNTHESIZER_H_
+
+#include <modules/elements/input/TsCrc32.h>
+#include <modules/elements/input/TsSync.h>
+#include "mpeg/ts.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <stdint.h>
+
+#define TS_SYNTH_PAT_PID 0
+#define TS_SYNTH_NULL_PID 0x1fff
+#define TS_SYNTH_PAYLOAD_SIZE (TS_SIZE - TS_HEADER_SIZE)
+#define TS_SYNTH_FILLER 0xff
+
+/** @brief parameters of the synthesized stream */
+struct TsSynthesizerConfig {
+    double bitRate = 10e6;          /** mux rate in bit/s, including null packets */
+    int videoPid = 0x100;
+    int audioPid = 0x101;
+    int pcrPid = 0x100;
+    int pmtPid = 0x1000;
+    int programNumber = 1;
+    int videoStreamType = 0x1b;     /** H.264 */
+    int audioStreamType = 0x03;     /** MPEG-1 audio */
+    double videoBitRate = 6e6;
+    double frameRate = 25;
+    int gopSize = 12;
+    int gopSizeMax = 12;
+    double iFrameRatio = 5;         /** size of an I frame relative to the other frames */
+    double sizeDeviation = 0.1;     /** standard deviation of the frame sizes, relative to their mean */
+    double audioBitRate = 128e3;
+    double audioFrameDuration = 0.024;
+    double pcrInterval = 0.04;
+    double psiInterval = 0.1;
+    double ptsDelay = 0.5;          /** PTS ahead of the PCR, at the time the frame is due to be muxed */
+    unsigned int seed = 1;
+};
+
+class TsSynthesizer {
+public:
+    void setup(const TsSynthesizerConfig& config) {
+        m_config = config;
+        m_random.seed(config.seed);
+        m_packetCount = 0;
+        m_nextPsi = 0;
+        m_nextPcr = 0;
+        m_nextVideo = 0;
+        m_nextAudio = 0;
+        m_frameInGop = 0;
+        m_gopLength = 0;
+        m_video = Stream();
+        m_audio = Stream();
+        m_video.pid = config.videoPid;
+        m_audio.pid = config.audioPid;
+        m_psiCc[0] = 0;
+        m_psiCc[1] = 0;
+        m_pcrCc = 0;
+        m_frames = 0;
+
+        // the mean frame size is videoBitRate / frameRate, the I frame takes iFrameRatio times a P frame
+        double gopMean = (config.gopSize + config.gopSizeMax) / 2.0;
+        double frameBytes = config.videoBitRate / 8 / config.frameRate;
+        m_pFrameSize = frameBytes * gopMean / (config.iFrameRatio + gopMean - 1);
+        m_audioFrameSize = std::max(1.0, config.audioBitRate / 8 * config.audioFrameDuration);
+
+        buildPsi();
+    }
+
+    /** @brief amount of video frames started */
+    uint64_t frames() const {
+        return m_frames;
+    }
+
+    /** @brief write the next packet of the stream.
+     *
+     * @param packet TS_SIZE bytes
+     */
+    void next(uint8_t* packet) {
+        double now = m_packetCount * TS_SIZE * 8 / m_config.bitRate;
+        m_packetCount++;
+
+        if (now >= m_nextPsi && m_psiPending == 0) {
+            m_psiPending = 2;
+            m_nextPsi += m_config.psiInterval;
+        }
+        if (m_psiPending > 0) {
+            writePsi(packet, 2 - m_psiPending);
+            m_psiPending--;
+            return;
+        }
+
+        if (now >= m_nextPcr) {
+            writePcr(packet, (uint64_t)(now * 27e6));
+            m_nextPcr += m_config.pcrInterval;
+            return;
+        }
+
+        if (m_audio.pos == m_audio.pes.size() && now >= m_nextAudio) {
+            buildPes(m_audio, 0xc0, m_audioFrameSize, m_nextAudio + m_config.ptsDelay, false, true);
+            m_nextAudio += m_config.audioFrameDuration;
+        }
+        if (m_audio.pos < m_audio.pes.size()) {
+            writePes(packet, m_audio);
+            return;
+        }
+
+        if (m_video.pos == m_video.pes.size() && now >= m_nextVideo) {
+            size_t frameSize = nextFrameSize();
+            buildPes(m_video, 0xe0, frameSize, m_nextVideo + m_config.ptsDelay, m_frameInGop == 1, false);
+            m_nextVideo += 1 / m_config.frameRate;
+            m_frames++;
+        }
+        if (m_video.pos < m_video.pes.size()) {
+            writePes(packet, m_video);
+            return;
+        }
+
+        writeNull(packet);
+    }
+
+private:
+    /** @brief an elementary stream, with its current PES packet */
+    struct Stream {
+        int pid = 0;
+        int cc = 0;
+        std::vector<uint8_t> pes;
+        size_t pos = 0;
+        bool randomAccess = false;
+    };
+
+    /** @brief size of the next video frame, following the GOP structure */
+    size_t nextFrameSize() {
+        if (m_frameInGop >= m_gopLength) {
+            std::uniform_int_distribution<int> gop(m_config.gopSize, std::max(m_config.gopSize, m_config.gopSizeMax));
+            m_gopLength = gop(m_random);
+            m_frameInGop = 0;
+        }
+        double mean = (m_frameInGop == 0) ? m_pFrameSize * m_config.iFrameRatio : m_pFrameSize;
+        m_frameInGop++;
+
+        std::normal_distribution<double> size(mean, mean * m_config.sizeDeviation);
+        return std::max(1.0, size(m_random));
+    }
+
+    static void writeTimestamp(uint8_t* p, uint8_t prefix, uint64_t ts) {
+        p[0] = (prefix << 4) | ((ts >> 29) & 0x0e) | 0x01;
+        p[1] = ts >> 22;
+        p[2] = ((ts >> 14) & 0xfe) | 0x01;
+        p[3] = ts >> 7;
+        p[4] = ((ts << 1) & 0xfe) | 0x01;
+    }
+
+    /** @brief build a PES packet with a PTS and filler payload
+     *
+     * @param bounded if true the PES length is set (audio), otherwise it is 0 (video)
+     */
+    void buildPes(Stream& stream, uint8_t streamId, size_t payloadSize, double pts, bool randomAccess, bool bounded) {
+        const size_t headerSize = 14;
+        stream.pes.resize(headerSize + payloadSize);
+        uint8_t* p = stream.pes.data();
+        size_t length = (bounded && payloadSize + 8 <= 0xffff) ? payloadSize + 8 : 0;
+
+        p[0] = 0x00;
+        p[1] = 0x00;
+        p[2] = 0x01;
+        p[3] = streamId;
+        p[4] = length >> 8;
+        p[5] = length & 0xff;
+        p[6] = 0x80;
+        p[7] = 0x80; // PTS only
+        p[8] = 5;
+        writeTimestamp(p + 9, 0x2, (uint64_t)(pts * 90000) & (((uint64_t)1 << 33) - 1));
+        memset(p + headerSize, TS_SYNTH_FILLER, payloadSize);
+
+        stream.pos = 0;
+        stream.randomAccess = randomAccess;
+    }
+
+    /** @brief write the TS header, and an adaptation field of afSize bytes (including its length byte)
+     *
+     * @return pointer behind the header
+     */
+    static uint8_t* writeHeader(uint8_t* packet, int pid, bool unitStart, int cc, size_t afSize, bool payload, uint8_t afFlags) {
+        packet[0] = TS_SYNC_BYTE;
+        packet[1] = (unitStart ? 0x40 : 0x00) | ((pid >> 8) & 0x1f);
+        packet[2] = pid & 0xff;
+        packet[3] = (afSize ? 0x20 : 0x00) | (payload ? 0x10 : 0x00) | (cc & 0x0f);
+
+        uint8_t* p = packet + TS_HEADER_SIZE;
+        if (afSize > 0) {
+            p[0] = afSize - 1;
+            if (afSize > 1) {
+                p[1] = afFlags;
+                memset(p + 2, TS_SYNTH_FILLER, afSize - 2);
+            }
+            p += afSize;
+        }
+        return p;
+    }
+
+    void writePes(uint8_t* packet, Stream& stream) {
+        bool unitStart = (stream.pos == 0);
+        bool randomAccess = unitStart && stream.randomAccess;
+        size_t remaining = stream.pes.size() - stream.pos;
+        size_t payload = std::min(remaining, (size_t)TS_SYNTH_PAYLOAD_SIZE - (randomAccess ? 2 : 0));
+        size_t afSize = TS_SYNTH_PAYLOAD_SIZE - payload;
+
+        uint8_t* p = writeHeader(packet, stream.pid, unitStart, stream.cc, afSize, true, randomAccess ? 0x40 : 0x00);
+        memcpy(p, stream.pes.data() + stream.pos, payload);
+        stream.pos += payload;
+        stream.cc = (stream.cc + 1) & 0x0f;
+    }
+
+    /** @brief a packet with only an adaptation field carrying the PCR. The cc doesn't count without payload. */
+    void writePcr(uint8_t* packet, uint64_t pcr) {
+        int cc = (m_config.pcrPid == m_video.pid) ? (m_video.cc + 15) & 0x0f
+               : (m_config.pcrPid == m_audio.pid) ? (m_audio.cc + 15) & 0x0f : m_pcrCc;
+        writeHeader(packet, m_config.pcrPid, false, cc, TS_SYNTH_PAYLOAD_SIZE, false, 0x10);
+
+        uint64_t base = (pcr / 300) & (((uint64_t)1 << 33) - 1);
+        uint64_t ext = pcr % 300;
+        uint8_t* af = packet + TS_HEADER_SIZE + 2;
+        af[0] = base >> 25;
+        af[1] = base >> 17;
+        af[2] = base >> 9;
+        af[3] = base >> 1;
+        af[4] = ((base << 7) & 0x80) | 0x7e | ((ext >> 8) & 0x01);
+        af[5] = ext & 0xff;
+    }
+
+    void writeNull(uint8_t* packet) {
+        uint8_t* p = writeHeader(packet, TS_SYNTH_NULL_PID, false, 0, 0, true, 0);
+        memset(p, TS_SYNTH_FILLER, TS_SYNTH_PAYLOAD_SIZE);
+    }
+
+    /** @brief write PAT (index 0) or PMT (index 1) */
+    void writePsi(uint8_t* packet, int index) {
+        int pid = (index == 0) ? TS_SYNTH_PAT_PID : m_config.pmtPid;
+        uint8_t* p = writeHeader(packet, pid, true, m_psiCc[index], 0, true, 0);
+        m_psiCc[index] = (m_psiCc[index] + 1) & 0x0f;
+        memcpy(p, m_psi[index], TS_SYNTH_PAYLOAD_SIZE);
+    }
+
+    /** @brief finish a section: set the length, append the CRC and fill the rest of the payload.
+     *
+     * @param payload payload of the packet, starting with the pointer field
+     * @param size size of the section without CRC
+     */
+    static void finishSection(uint8_t* payload, size_t size) {
+        uint8_t* section = payload + 1;
+        size_t length = size - 3 + 4;
+        section[1] = 0xb0 | ((length >> 8) & 0x0f);
+        section[2] = length & 0xff;
+        uint32_t crc = tsCrc32(section, size);
+        section[size] = crc >> 24;
+        section[size + 1] = crc >> 16;
+        section[size + 2] = crc >> 8;
+        section[size + 3] = crc;
+        memset(section + size + 4, TS_SYNTH_FILLER, TS_SYNTH_PAYLOAD_SIZE - 1 - size - 4);
+    }
+
+    void buildPsi() {
+        // PAT
+        uint8_t* p = m_psi[0];
+        p[0] = 0; // pointer field
+        uint8_t* s = p + 1;
+        s[0] = 0x00;  // table id
+        s[3] = 0x00;  // transport stream id
+        s[4] = 0x01;
+        s[5] = 0xc1;  // version 0, current
+        s[6] = 0x00;  // section number
+        s[7] = 0x00;  // last section number
+        s[8] = m_config.programNumber >> 8;
+        s[9] = m_config.programNumber & 0xff;
+        s[10] = 0xe0 | ((m_config.pmtPid >> 8) & 0x1f);
+        s[11] = m_config.pmtPid & 0xff;
+        finishSection(p, 12);
+
+        // PMT
+        p = m_psi[1];
+        p[0] = 0;
+        s = p + 1;
+        s[0] = 0x02;
+        s[3] = m_config.programNumber >> 8;
+        s[4] = m_config.programNumber & 0xff;
+        s[5] = 0xc1;
+        s[6] = 0x00;
+        s[7] = 0x00;
+        s[8] = 0xe0 | ((m_config.pcrPid >> 8) & 0x1f);
+        s[9] = m_config.pcrPid & 0xff;
+        s[10] = 0xf0; // no program info
+        s[11] = 0x00;
+        size_t pos = 12;
+        const int streams[2][2] = {{m_config.videoStreamType, m_config.videoPid}, {m_config.audioStreamType, m_config.audioPid}};
+        for (int i = 0; i < 2; i++) {
+            s[pos] = streams[i][0];
+            s[pos + 1] = 0xe0 | ((streams[i][1] >> 8) & 0x1f);
+            s[pos + 2] = streams[i][1] & 0xff;
+            s[pos + 3] = 0xf0; // no es info
+            s[pos + 4] = 0x00;
+            pos += 5;
+        }
+        finishSection(p, pos);
+    }
+
+    TsSynthesizerConfig m_config;
+    std::mt19937 m_random;
+    uint64_t m_packetCount = 0;
+    uint64_t m_frames = 0;
+    double m_nextPsi = 0;
+    double m_nextPcr = 0;
+    double m_nextVideo = 0;
+    double m_nextAudio = 0;
+    int m_psiPending = 0;
+    int m_frameInGop = 0;
+    int m_gopLength = 0;
+    double m_pFrameSize = 0;
+    size_t m_audioFrameSize = 0;
+    Stream m_video;
+    Stream m_audio;
+    int m_psiCc[2];
+    int m_pcrCc = 0;
+    uint8_t m_psi[2][TS_SYNTH_PAYLOAD_SIZE]; /** payload of the PAT and the PMT packet */
+};
+
+#undef TS_SYNTH_PAT_PID
+#undef TS_SYNTH_NULL_PID
+#undef TS_SYNTH_PAYLOAD_SIZE
+#undef TS_SYNTH_FILLER
+#endif /* INPUT_TSSYNTHESIZER_H_ */
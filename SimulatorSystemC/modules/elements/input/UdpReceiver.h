@@ -0,0 +1,274 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file receives UDP datagrams in a host thread, many per system call.
+ *
+ * A separate thread receives the datagrams with recvmmsg into batches of a lock free ring, so the
+ * simulation kernel is never blocked by the socket. Every datagram gets the kernel receive time
+ * (SO_TIMESTAMPNS). If the simulation doesn't keep up and the ring is full, datagrams are dropped,
+ * like a full socket buffer would.
+ */
+
+#ifndef INPUT_UDPRECEIVER_H_
+#define INPUT_UDPRECEIVER_H_
+
+#include "framework/SpscRing.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define UDP_DATAGRAM_SIZE 2048 /** larger than any datagram of a 1500 byte MTU */
+#define UDP_RECEIVE_BATCHES 64
+#define UDP_RECEIVE_TIMEOUT_US 100000 /** how often the receive thread checks for stop */
+
+/** @brief datagrams received with one system call */
+struct UdpBatch {
+    std::vector<uint8_t> data;   /** UDP_DATAGRAM_SIZE bytes per datagram */
+    std::vector<size_t> sizes;
+    std::vector<uint64_t> times; /** receive time in nanoseconds (CLOCK_REALTIME) */
+    size_t count = 0;
+
+    const uint8_t* datagram(size_t index) const {
+        return data.data() + index * UDP_DATAGRAM_SIZE;
+    }
+};
+
+class UdpReceiver {
+public:
+    UdpReceiver():
+        m_ring(UDP_RECEIVE_BATCHES)
+    {
+    };
+
+    ~UdpReceiver() {
+        stop();
+    }
+
+    /** @brief open the socket, and start receiving.
+     *
+     * @param address local address to bind to. If it is a multicast group, the group is joined.
+     * @param port UDP port
+     * @param interface address of the interface to join the multicast group on, empty for the default
+     * @param batchSize maximal amount of datagrams received with one system call
+     * @param receiveBuffer size of the socket receive buffer in bytes, 0 keeps the system default
+     *
+     * @return false if the socket could not be set up
+     */
+    bool open(const std::string& address, int port, const std::string& interface, int batchSize, int receiveBuffer) {
+        stop();
+
+        struct sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_port = htons(port);
+        if (inet_pton(AF_INET, address.c_str(), &local.sin_addr) != 1) {
+            return false;
+        }
+
+        m_fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (m_fd < 0) {
+            return false;
+        }
+
+        int on = 1;
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = UDP_RECEIVE_TIMEOUT_US;
+        setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        setsockopt(m_fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+        setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (receiveBuffer > 0) {
+            setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+        }
+
+        if (bind(m_fd, (struct sockaddr*)&local, sizeof(local)) != 0) {
+            stop();
+            return false;
+        }
+
+        if (IN_MULTICAST(ntohl(local.sin_addr.s_addr))) {
+            struct ip_mreq request;
+            request.imr_multiaddr = local.sin_addr;
+            request.imr_interface.s_addr = htonl(INADDR_ANY);
+            if (!interface.empty() && inet_pton(AF_INET, interface.c_str(), &request.imr_interface) != 1) {
+                stop();
+                return false;
+            }
+            if (setsockopt(m_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) != 0) {
+                stop();
+                return false;
+            }
+        }
+
+        m_batchSize = batchSize;
+        m_dropped = 0;
+        m_stop = false;
+        m_thread = std::thread(&UdpReceiver::receive, this);
+        return true;
+    }
+
+    /** @brief get the oldest received batch
+     *
+     * @return the batch, or NULL if nothing was received
+     */
+    UdpBatch* batch() {
+        return m_ring.consumerSlot();
+    }
+
+    /** @brief block the calling thread, till a batch is received or the timeout passed.
+     *
+     * @param timeout in nanoseconds
+     */
+    void waitForBatch(uint64_t timeout) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_published.wait_for(lock, std::chrono::nanoseconds(timeout), [this] { return m_ring.consumerSlot() != NULL; });
+    }
+
+    /** @brief give the batch from @batch() back to the receive thread
+     */
+    void consume() {
+        m_ring.consume();
+    }
+
+    /** @brief amount of datagrams dropped, because the ring was full
+     */
+    unsigned long dropped() const {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    /** @brief the wall clock, the receive times are given in
+     */
+    static uint64_t now() {
+        struct timespec time;
+        clock_gettime(CLOCK_REALTIME, &time);
+        return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+    }
+
+    /** @brief stop the receive thread, and close the socket.
+     */
+    void stop() {
+        m_stop = true;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        while (m_ring.consumerSlot() != NULL) {
+            m_ring.consume();
+        }
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+private:
+    /** @brief runs in the receive thread, fills the ring until stop() is called.
+     */
+    void receive() {
+        std::vector<struct mmsghdr> messages(m_batchSize);
+        std::vector<struct iovec> vectors(m_batchSize);
+        std::vector<uint8_t> control(m_batchSize * CMSG_SPACE(sizeof(struct timespec)));
+        UdpBatch scratch; // receives the datagrams, that are dropped
+
+        while (!m_stop.load(std::memory_order_relaxed)) {
+            UdpBatch* batch = m_ring.producerSlot();
+            bool drop = (batch == NULL);
+            if (drop) {
+                batch = &scratch;
+            }
+            batch->data.resize(m_batchSize * UDP_DATAGRAM_SIZE);
+            batch->sizes.resize(m_batchSize);
+            batch->times.resize(m_batchSize);
+
+            for (int i = 0; i < m_batchSize; i++) {
+                vectors[i].iov_base = batch->data.data() + i * UDP_DATAGRAM_SIZE;
+                vectors[i].iov_len = UDP_DATAGRAM_SIZE;
+                memset(&messages[i], 0, sizeof(messages[i]));
+                messages[i].msg_hdr.msg_iov = &vectors[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+                messages[i].msg_hdr.msg_control = control.data() + i * CMSG_SPACE(sizeof(struct timespec));
+                messages[i].msg_hdr.msg_controllen = CMSG_SPACE(sizeof(struct timespec));
+            }
+
+            // blocks till the first datagram, then takes what is already there
+            int received = recvmmsg(m_fd, messages.data(), m_batchSize, MSG_WAITFORONE, NULL);
+            if (received <= 0) {
+                // timeout, or interrupted
+                continue;
+            }
+
+            if (drop) {
+                m_dropped.fetch_add(received, std::memory_order_relaxed);
+                continue;
+            }
+
+            uint64_t now = UdpReceiver::now();
+            for (int i = 0; i < received; i++) {
+                batch->sizes[i] = messages[i].msg_len;
+                batch->times[i] = now;
+                for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&messages[i].msg_hdr); cmsg != NULL;
+                     cmsg = CMSG_NXTHDR(&messages[i].msg_hdr, cmsg)) {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                        struct timespec time;
+                        memcpy(&time, CMSG_DATA(cmsg), sizeof(time));
+                        batch->times[i] = (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+                    }
+                }
+            }
+            batch->count = received;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_ring.publish();
+            }
+            m_published.notify_one();
+        }
+    }
+
+    UdpReceiver(const UdpReceiver&);             // disable copy
+    UdpReceiver& operator= (const UdpReceiver&); // disable =
+
+    SpscRing<UdpBatch> m_ring;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_published; // a batch was published
+    std::atomic<bool> m_stop{false};
+    std::atomic<unsigned long> m_dropped{0};
+    int m_batchSize = 1;
+    int m_fd = -1;
+};
+
+#undef UDP_DATAGRAM_SIZE
+#undef UDP_RECEIVE_BATCHES
+#undef UDP_RECEIVE_TIMEOUT_US
+#endif /* INPUT_UDPRECEIVER_H_ */
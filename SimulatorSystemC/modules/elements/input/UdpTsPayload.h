@@ -0,0 +1,87 @@
+/**
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2015 Digisoft.tv Ltd.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * @file find the TS packets in the payload of a UDP datagram.
+ *
+ * TS over UDP is sent either plain (SMPTE 2022 without FEC, multicat default) or with an RTP header
+ * (RFC 2250). The RTP header is skipped, including CSRCs, header extension and padding.
+ */
+
+#ifndef INPUT_UDPTSPAYLOAD_H_
+#define INPUT_UDPTSPAYLOAD_H_
+
+#include <modules/elements/input/TsSync.h>
+#include "mpeg/ts.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define RTP_HEADER_SIZE 12
+#define RTP_VERSION 2
+
+/** @brief get the TS packets of a UDP payload.
+ *
+ * @param[in] data UDP payload
+ * @param[in] size size of the UDP payload
+ * @param[out] ts first TS packet
+ * @param[out] count amount of TS packets
+ *
+ * @return false if the payload doesn't contain whole TS packets
+ */
+inline bool udpTsPayload(const uint8_t* data, size_t size, const uint8_t*& ts, size_t& count)
+{
+    if (size > 0 && data[0] != TS_SYNC_BYTE) {
+        if (size < RTP_HEADER_SIZE || (data[0] >> 6) != RTP_VERSION) {
+            return false;
+        }
+
+        size_t header = RTP_HEADER_SIZE + 4 * (data[0] & 0x0f);
+        if ((data[0] & 0x10) && size >= header + 4) {
+            // header extension, the length is given in 32 bit words
+            header += 4 + 4 * ((data[header + 2] << 8) | data[header + 3]);
+        }
+        if (size < header) {
+            return false;
+        }
+        size_t padding = 0;
+        if ((data[0] & 0x20) && size > header) {
+            // padding, the last byte holds the amount
+            padding = data[size - 1];
+        }
+        if (size - header < padding) {
+            return false;
+        }
+        size -= header + padding;
+        data += header;
+    }
+
+    if (size < TS_SIZE || size % TS_SIZE != 0 || data[0] != TS_SYNC_BYTE) {
+        return false;
+    }
+    ts = data;
+    count = size / TS_SIZE;
+    return true;
+}
+
+#undef RTP_HEADER_SIZE
+#undef RTP_VERSION
+#endif /* INPUT_UDPTSPAYLOAD_H_ */
@@ -33,6 +33,7 @@
 
 #include <modules/elements/buffers/BufferFiFo.h>
 #include <modules/elements/buffers/BufferPicture.h>
+#include <modules/elements/buffers/PicturePool.h>
 #include "systemc.h"
 #include "mpeg/ts.h"
 #include "mpeg/pes.h"
@@ -40,6 +41,7 @@
 #include <cstring> // memcpy
 #include "framework/Configuration.h"
 #include "framework/CsvTrace.h"
+#include "framework/AllocationTracker.h"
 
 #define MODULE_ID_STR "/digisoft/simulator/modules/elements/pesDecoder/AudioDecoder"
 
@@ -68,6 +70,7 @@ SC_MODULE(AudioDecoder)
     sc_time framesPerMinuteLastTime;
 
     std::shared_ptr<CsvTrace> m_csvTrace;
+    PicturePool m_framePool; /** the decoded frames, recycled when the audio buffer drops them */
 
 
 
@@ -109,13 +112,17 @@ SC_MODULE(AudioDecoder)
      *
      */
     void process() {
-        uint8_t* esPacket;
+        std::shared_ptr<uint8_t> esPacket;
         int64_t pts;
         int64_t stc;
         int64_t stcOffset;
         int size;
         int64_t key;
 
+        // start decoding, when the bitstream buffer is filled up to its "highWatermark". After an underrun the
+        // read waits for it again (see BufferChannel::waitForData()), so the decoder does not run on every PES.
+        esPacketIn->waitHighWatermark();
+
         while (true) {
             esPacketIn->read(esPacket, pts, size);
 
@@ -133,8 +140,13 @@ SC_MODULE(AudioDecoder)
             timeToPresentIncludingStcOffset = pts - stcOffset;
 
 
-            key = audioOut->write(esPacket, pts, size);
-            audioOut->finished(std::list<int64_t>(1, key));
+            // the decoded frame goes into own memory, and the PES back to the bitstream buffer (e.g. its ring)
+            std::shared_ptr<uint8_t> frame = m_framePool.get(size);
+            std::memcpy(frame.get(), esPacket.get(), size);
+            esPacket.reset();
+
+            key = audioOut->write(frame, pts, size);
+            audioOut->finished(key);
 
             if((sc_time_stamp()-framesPerSecondLastTime)>sc_time(1,SC_SEC))
             {
@@ -154,6 +166,7 @@ SC_MODULE(AudioDecoder)
     }
     SC_CTOR(AudioDecoder) {
         loadConfig();
+        m_framePool.setAccount(AllocationTracker::getInstance().account(this->name()));
         SC_THREAD(process);
     }
 
@@ -34,6 +34,7 @@
 #define MODULES_ELEMENTS_PESDECODER_VIDEODECODER_H_
 
 #include <modules/elements/buffers/BufferPicture.h>
+#include <modules/elements/buffers/PicturePool.h>
 #include "systemc.h"
 #include <stdint.h>
 #include <cstring> // memcpy
@@ -41,13 +42,12 @@
 #include "../buffers/BufferDecoder.h"
 #include "framework/Configuration.h"
 #include "framework/CsvTrace.h"
+#include "framework/AllocationTracker.h"
 
 #define MODULE_ID_STR "/digisoft/simulator/modules/elements/pesDecoder/VideoDecoder"
 #define STC_COUNT_PER_SECOND 90e3
 #define BITSTREAM_MPEG_VIDEO "13818-2 video (MPEG-2)"
 
-#define PICT_BUFFER_SIZE 4000000 //4MB
-
 SC_MODULE(VideoDecoder)
 {
     sc_port<BufferDecoderInIf> esPacketIn;
@@ -77,6 +77,7 @@ SC_MODULE(VideoDecoder)
     double decodingTime = 0;
 
     std::shared_ptr<CsvTrace> m_csvTrace;
+    PicturePool m_picturePool; /** the pictures cut out of the PES, recycled when BufferPicture drops them */
 
     /** @brief load the configuration
      *
@@ -143,7 +144,7 @@ SC_MODULE(VideoDecoder)
      *
      */
     void process() {
-        uint8_t* esPacket;
+        std::shared_ptr<uint8_t> esPacket;
         int64_t pts;
         int64_t key;
         int size;
@@ -151,6 +152,10 @@ SC_MODULE(VideoDecoder)
         int64_t stcOffset;
 
 
+        // start decoding, when the bitstream buffer is filled up to its "highWatermark". After an underrun the
+        // read waits for it again (see BufferChannel::waitForData()), so the decoder does not run on every PES.
+        esPacketIn->waitHighWatermark();
+
         while (true) {
             esPacketIn->read(esPacket, pts, size);
 
@@ -172,19 +177,20 @@ SC_MODULE(VideoDecoder)
             if(videoTyp == BITSTREAM_MPEG_VIDEO)
             {
                 countPict = 0;
+                uint8_t* es = esPacket.get();
                 int pictStart = 0;
-                uint8_t* pictBuff;
+                std::shared_ptr<uint8_t> pictBuff;
                 int pictBuffSize = 0;
 
                 for(int i = 0; i < size-3;i++)
                 {
-                    if((esPacket[i+0] == 0x00) &&
-                       (esPacket[i+1] == 0x00) &&
-                       (esPacket[i+2] == 0x01) &&
-                       (esPacket[i+3] == 0xb3))
+                    if((es[i+0] == 0x00) &&
+                       (es[i+1] == 0x00) &&
+                       (es[i+2] == 0x01) &&
+                       (es[i+3] == 0xb3))
                     {
                         //sequence header found, look for frame rate:
-                        switch (esPacket[7] & 0x0f)
+                        switch (es[7] & 0x0f)
                         {
                             case 0b0001:
                                 framerate = 24/1.001;
@@ -216,18 +222,18 @@ SC_MODULE(VideoDecoder)
                         }
                     }
 
-                    if((esPacket[i+0] == 0x00) &&
-                       (esPacket[i+1] == 0x00) &&
-                       (esPacket[i+2] == 0x01) &&
-                       (esPacket[i+3] == 0x00))
+                    if((es[i+0] == 0x00) &&
+                       (es[i+1] == 0x00) &&
+                       (es[i+2] == 0x01) &&
+                       (es[i+3] == 0x00))
                     {
                         if (pictStart != 0)
                         {
-                            pictBuff = new uint8_t[PICT_BUFFER_SIZE];
                             pictBuffSize = i - pictStart;
-                            std::memcpy(pictBuff, esPacket + pictStart, pictBuffSize);
+                            pictBuff = m_picturePool.get(pictBuffSize);
+                            std::memcpy(pictBuff.get(), es + pictStart, pictBuffSize);
                             key = pictureOut->write(pictBuff, pts + (int)(((1.0/framerate) * countPict) * STC_COUNT_PER_SECOND), pictBuffSize);
-                            pictureOut->finished(std::list<int64_t>(1, key));
+                            pictureOut->finished(key);
                             countPict ++;
                         }
                         pictStart = i;
@@ -237,27 +243,28 @@ SC_MODULE(VideoDecoder)
                 // copy the last picture
                 if (pictStart != 0)
                 {
-                    pictBuff = new uint8_t[PICT_BUFFER_SIZE];
                     pictBuffSize = size - pictStart;
-                    std::memcpy(pictBuff, esPacket + pictStart, pictBuffSize);
+                    pictBuff = m_picturePool.get(pictBuffSize);
+                    std::memcpy(pictBuff.get(), es + pictStart, pictBuffSize);
                     key = pictureOut->write(pictBuff, pts + (int)(((1.0/framerate) * countPict) * STC_COUNT_PER_SECOND), pictBuffSize);
-                    pictureOut->finished(std::list<int64_t>(1, key));
-                    delete[] esPacket;
+                    pictureOut->finished(key);
                 }
                 else
                 {
                     // there seem to bee al lot of streams that have no picture header, so just push the pes packet
-                    key = pictureOut->write(esPacket, pts, size);
-                    pictureOut->finished(std::list<int64_t>(1, key));
+                    key = pictureOut->write(decoded(esPacket.get(), size), pts, size);
+                    pictureOut->finished(key);
                 }
             }
             else
             {
                 //fallback for other videos that are not mpeg
-                key = pictureOut->write(esPacket, pts, size);
-                pictureOut->finished(std::list<int64_t>(1, key));
+                key = pictureOut->write(decoded(esPacket.get(), size), pts, size);
+                pictureOut->finished(key);
 
             }
+            // decoding is done, give the PES back to the bitstream buffer (e.g. its ring) while waiting for the next
+            esPacket.reset();
         
             if((sc_time_stamp() - framesPerSecondLastTime) > sc_time(1, SC_SEC))
             {
@@ -276,8 +283,17 @@ SC_MODULE(VideoDecoder)
         }
     }
 
+    /** @brief copy a decoded picture into memory of the pool, so the PES is not held till the picture is presented.
+     */
+    std::shared_ptr<uint8_t> decoded(const uint8_t* data, int size) {
+        std::shared_ptr<uint8_t> picture = m_picturePool.get(size);
+        std::memcpy(picture.get(), data, size);
+        return picture;
+    }
+
     SC_CTOR(VideoDecoder) {
         loadConfig();
+        m_picturePool.setAccount(AllocationTracker::getInstance().account(this->name()));
         SC_THREAD(process);
     }
 
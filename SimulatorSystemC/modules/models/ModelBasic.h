@@ -31,6 +31,7 @@
 #include <modules/elements/buffers/BufferFill.h>
 #include <modules/elements/buffers/BufferPicture.h>
 #include <modules/elements/buffers/BufferDecoder.h>
+#include <modules/elements/buffers/SharedMemoryPool.h>
 #include <modules/elements/demux/DemuxSplit.h>
 #include <modules/elements/OutPut.h>
 #include <modules/elements/pesDecoder/AudioDecoder.h>
@@ -39,14 +40,22 @@
 #include <modules/elements/stc/StcOffset.h>
 #include <modules/elements/Sync.h>
 #include <modules/elements/TunerDVB.h>
+#include <modules/elements/ReadMulticast.h>
+#include <modules/elements/ReadPcap.h>
+#include <modules/elements/ReadUdp.h>
+#include <modules/elements/TsGenerator.h>
+#include <modules/elements/RemuxMpts.h>
 
 #include "systemc.h"
+#include "framework/Configuration.h"
+#include <memory>
+#include <string>
 
 
 
 SC_MODULE(ModelBasic)
 {
-    TunerDVB read;
+    std::shared_ptr<sc_module> read; /** the input element, see createRead() */
     BufferFill demuxInBuffer;
     DemuxSplit demux;
     Stc stc;
@@ -67,18 +76,90 @@ SC_MODULE(ModelBasic)
     sc_buffer<bool> stcRequ;
     sc_buffer<int64_t> stcStcOffsetChan;
     sc_buffer<bool> stcOffsetRequ;
-    sc_buffer<uint8_t*> outPutVideoGet;
+    sc_buffer<std::shared_ptr<uint8_t> > outPutVideoGet;
     sc_buffer<bool> outPutVideoRequ;
-    sc_buffer<uint8_t*> outPutAudioGet;
+    sc_buffer<std::shared_ptr<uint8_t> > outPutAudioGet;
     sc_buffer<bool> outPutAudioRequ;
 
     sc_signal<bool> stcStarted;
 
+    std::shared_ptr<SharedMemoryPool> memoryPool; /** only with a configuration for "memoryPool", see createMemoryPool() */
 
 
+    /** @brief create the input element, and connect it to the demux.
+     *
+     * The element is chosen with "element" in the configuration of "read": "TunerDVB" (default),
+     * "ReadMulticast", "ReadPcap", "ReadUdp", "TsGenerator" or "RemuxMpts".
+     */
+    void createRead() {
+        Configuration& config = Configuration::getInstance();
+        std::string configName = std::string(this->name()).append(".read");
+        std::string id = "TunerDVB";
+
+        if (config.HasMember(configName.c_str()) && config[configName.c_str()].HasMember("element")) {
+            if (!config[configName.c_str()]["element"].IsString()) {
+                std::string message;
+                message += "Malformed configuration for: \"";
+                message += configName;
+                message += "\". \"element\" is no String";
+                SC_REPORT_FATAL("/digisoft/simulator/ModelBasic", message.c_str());
+            }
+            id = config[configName.c_str()]["element"].GetString();
+        }
+
+        if (id == "TunerDVB") {
+            std::shared_ptr<TunerDVB> tuner = std::make_shared<TunerDVB>("read");
+            tuner->out(demuxInBuffer);
+            read = tuner;
+        } else if (id == "ReadMulticast") {
+            std::shared_ptr<ReadMulticast> multicast = std::make_shared<ReadMulticast>("read");
+            multicast->out(demuxInBuffer);
+            read = multicast;
+        } else if (id == "ReadPcap") {
+            std::shared_ptr<ReadPcap> pcap = std::make_shared<ReadPcap>("read");
+            pcap->out(demuxInBuffer);
+            read = pcap;
+        } else if (id == "ReadUdp") {
+            std::shared_ptr<ReadUdp> udp = std::make_shared<ReadUdp>("read");
+            udp->out(demuxInBuffer);
+            read = udp;
+        } else if (id == "TsGenerator") {
+            std::shared_ptr<TsGenerator> generator = std::make_shared<TsGenerator>("read");
+            generator->out(demuxInBuffer);
+            read = generator;
+        } else if (id == "RemuxMpts") {
+            std::shared_ptr<RemuxMpts> remux = std::make_shared<RemuxMpts>("read");
+            remux->out(demuxInBuffer);
+            read = remux;
+        } else {
+            std::string message;
+            message += "Malformed configuration for: \"";
+            message += configName;
+            message += "\". unknown \"element\": ";
+            message += id;
+            SC_REPORT_FATAL("/digisoft/simulator/ModelBasic", message.c_str());
+        }
+    }
+
+    /** @brief if there is a configuration for "memoryPool", the decoder buffers allocate from one SharedMemoryPool.
+     *
+     * Their "size" is then their share of the pool.
+     */
+    void createMemoryPool() {
+        Configuration& config = Configuration::getInstance();
+        std::string configName = std::string(this->name()).append(".memoryPool");
+
+        if (!config.HasMember(configName.c_str())) {
+            return;
+        }
+
+        memoryPool = std::make_shared<SharedMemoryPool>("memoryPool");
+        videoDecoderBuffer.setPool(memoryPool.get());
+        audioDecoderBuffer.setPool(memoryPool.get());
+    }
+
     SC_CTOR(ModelBasic)
-        :read("read")
-        ,demuxInBuffer("demuxInBuffer")
+        :demuxInBuffer("demuxInBuffer")
         ,demux("demux")
         ,stc("stc")
         ,stcOffset("stcOffset")
@@ -106,7 +187,8 @@ SC_MODULE(ModelBasic)
     {
         //connect Modules
         //read-->demux
-        read.out(demuxInBuffer);
+        createRead();
+        createMemoryPool();
         demux.in(demuxInBuffer);
         //demux --> pesDecoderVideo:
         demux.videoOut(videoDecoderBuffer);
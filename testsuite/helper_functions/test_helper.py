@@ -36,6 +36,8 @@ from Cheetah.Template import Template
 import logging
 import sys
 import unittest
+import socket
+import time
 
 
 
@@ -261,6 +263,73 @@ class SimulatorBaseTest(unittest.TestCase):
         self.assertFalse(reportLogFatal, "An a Fatal error has occurred in a Simulation. See logging.")
 
 
+def sendUdp(filename, address, port, bitRate, duration):
+    '''
+    send a TS file as UDP datagrams with 7 packets each (like multicat), paced with the given bitrate.
+    Used to feed the simulator over loopback.
+
+    filename [in] TS file to send
+    address [in] destination address
+    port [in] destination port
+    bitRate [in] bitrate of the file in bit/s
+    duration [in] stop after this amount of seconds, or at the end of the file
+    '''
+    datagramSize = 7 * 188
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    start = time.time()
+    sent = 0
+    with open(filename, "rb") as f:
+        while time.time() - start < duration:
+            data = f.read(datagramSize)
+            if len(data) < datagramSize:
+                break
+            sock.sendto(data, (address, port))
+            sent = sent + 1
+            # sleep till the next datagram is due
+            due = start + sent * datagramSize * 8.0 / bitRate
+            if due > time.time():
+                time.sleep(due - time.time())
+    sock.close()
+
+
+def cutStream(filename, target, bitRate, duration):
+    '''
+    write the first seconds of a TS file into a new file, e.g. to get a short clip for loop tests.
+
+    filename [in] TS file to cut
+    target [in] file to write the clip to
+    bitRate [in] bitrate of the file in bit/s
+    duration [in] length of the clip in seconds
+    '''
+    size = int(bitRate * duration / 8 / 188) * 188
+    with open(filename, "rb") as f:
+        data = f.read(size)
+    with open(target, "wb") as f:
+        f.write(data)
+
+
+def waitForLog(logFile, text, timeout):
+    '''
+    wait till a line with text shows up in the log file of a simulation, e.g. till an element is ready.
+
+    logFile [in] stdout log file of the simulation
+    text [in] text to wait for
+    timeout [in] give up after this amount of seconds
+
+    return True if the text was found, False on timeout
+    '''
+    start = time.time()
+    while time.time() - start < timeout:
+        try:
+            with open(logFile) as f:
+                if text in f.read():
+                    return True
+        except IOError:
+            pass
+        time.sleep(0.05)
+    return False
+
+
 def checkConstantAudio(file):
     '''
     check if delta pts of audio is constrant. logg error if not.
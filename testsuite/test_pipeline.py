@@ -29,6 +29,7 @@ import os
 from helper_functions.process_handler import ProcessHandler  
 import helper_functions.test_helper as th
 import shutil
+import re
 logging.basicConfig(format='%(asctime)s:%(levelname)s:%(name)s:%(filename)s:%(message)s', level=logging.INFO)
 
 
@@ -39,6 +40,61 @@ class Test(th.SimulatorBaseTest):
     def tearDown(self):
         pass
 
+    def fileConfig(self, file):
+        '''
+        configuration of the basic pipeline, reading the given file from the stream database with the TunerDVB.
+        '''
+        config = {}
+        config["mainModel"] = "ModelBasic"
+        config["runTime"] = int(file["duration"])
+        config["ModelBasic.read"] = {}
+        config["ModelBasic.read"]["trace"] = True
+        config["ModelBasic.read"]["filename"] = file["stream"]
+        config["ModelBasic.read"]["bitRate"] = file["overallBitrate"]
+        config["ModelBasic.demuxInBuffer"] = {}
+        config["ModelBasic.demuxInBuffer"]["size"] = 1
+        config["ModelBasic.demuxInBuffer"]["trace"] = False
+        config["ModelBasic.demux"] = {}
+        config["ModelBasic.demux"]["trace"] = True
+        config["ModelBasic.demux"]["videoPid"] = file["videoPid"]
+        config["ModelBasic.demux"]["audioPid"] = file["audioPid"]
+        config["ModelBasic.demux"]["pcrPid"] = file["pcrPid"]
+        config["ModelBasic.stc"] = {}
+        config["ModelBasic.stc"]["pcrJumpBorder"] = 100000000 # 3.7s 
+        config["ModelBasic.stc"]["trace"] = True
+        config["ModelBasic.stcOffset"] = {}
+        config["ModelBasic.stcOffset"]["offset"] = 8000000 #88.8 s * 90e3Hz
+        config["ModelBasic.stcOffset"]["trace"] = False 
+        config["ModelBasic.videoDecoderBuffer"] = {}
+        config["ModelBasic.videoDecoderBuffer"]["trace"] = True
+        config["ModelBasic.videoDecoderBuffer"]["size"] = 3 * 1024 * 1024
+        config["ModelBasic.videoDecoder"] = {}
+        config["ModelBasic.videoDecoder"]["trace"] = True
+        config["ModelBasic.videoDecoder"]["decodingTime"] = 0.005 #5ms
+        config["ModelBasic.videoDecoder"]["videoTyp"] = file["videoBitStreamFormat"]
+        config["ModelBasic.pictureBuffer"] = {} 
+        config["ModelBasic.pictureBuffer"]["trace"] = True
+        config["ModelBasic.pictureBuffer"]["size"] = int(4000*1024*1024 / (file["width"]*file["height"]*1.5))
+        config["ModelBasic.syncVideo"] = {}
+        config["ModelBasic.syncVideo"]["trace"] = False
+        config["ModelBasic.outPutVideo"] = {}
+        config["ModelBasic.outPutVideo"]["trace"] = True
+        config["ModelBasic.outPutVideo"]["framerate"] = float(file["frameRate"])
+        config["ModelBasic.audioDecoderBuffer"] = {}
+        config["ModelBasic.audioDecoderBuffer"]["size"] = 1 * 1024 * 1024
+        config["ModelBasic.audioDecoderBuffer"]["trace"] = True
+        config["ModelBasic.audioDecoder"] = {}
+        config["ModelBasic.audioDecoder"]["trace"] = True
+        config["ModelBasic.audioBuffer"] = {}
+        config["ModelBasic.audioBuffer"]["trace"] = True
+        config["ModelBasic.audioBuffer"]["size"] = int(20*1024*1024/(float(file["mindPts"])/90e3 * 48e3 * 2))
+        config["ModelBasic.syncAudio"] = {}
+        config["ModelBasic.syncAudio"]["trace"] = False
+        config["ModelBasic.outPutAudio"] = {}
+        config["ModelBasic.outPutAudio"]["trace"] = True
+        config["ModelBasic.outPutAudio"]["framerate"] = 1/(float(file["mindPts"])/90e3)
+        return config
+
     def test_pipeline_sintel(self):
         '''
         configure the basic pipeline
@@ -219,7 +275,327 @@ class Test(th.SimulatorBaseTest):
         th.buildOutputHtml(testDir, simDirs, head, description,"Simulation of a test pipeline","Simulation of a test pipeline")
         self.checkSimulation(simStatus)
 
+    def test_pipeline_generator(self):
+        '''
+        configure the basic pipeline, fed by the synthetic stream of the TsGenerator.
+        Needs no stream files, so the result is reproducible.
+        '''
+                
+        testEnviroment = th.TestEnviroment()
+        testDir = testEnviroment.mainResultDir + "/test_pipeline_generator"
+        shutil.rmtree(testDir, ignore_errors = True)
+        
+        config = {}
+        config["mainModel"] = "ModelBasic"
+        config["ModelBasic.read"] = {}
+        config["ModelBasic.read"]["trace"] = True
+        config["ModelBasic.read"]["element"] = "TsGenerator"
+        config["ModelBasic.read"]["bitRate"] = 10e6
+        config["ModelBasic.read"]["videoBitRate"] = 6e6
+        config["ModelBasic.read"]["gopSize"] = 12
+        config["ModelBasic.read"]["gopSizeMax"] = 24
+        config["ModelBasic.read"]["seed"] = 1
+        config["ModelBasic.demuxInBuffer"] = {}
+        config["ModelBasic.demuxInBuffer"]["size"] = 1
+        config["ModelBasic.demuxInBuffer"]["trace"] = False
+        config["ModelBasic.demux"] = {}
+        config["ModelBasic.demux"]["trace"] = True
+        config["ModelBasic.stc"] = {}
+        config["ModelBasic.stc"]["pcrJumpBorder"] = 100000000 # 3.7s 
+        config["ModelBasic.stc"]["trace"] = True
+        config["ModelBasic.stcOffset"] = {}
+        config["ModelBasic.stcOffset"]["offset"] = 0
+        config["ModelBasic.stcOffset"]["trace"] = False 
+        config["ModelBasic.videoDecoderBuffer"] = {}
+        config["ModelBasic.videoDecoderBuffer"]["trace"] = True
+        config["ModelBasic.videoDecoderBuffer"]["size"] = 3 * 1024 * 1024
+        config["ModelBasic.videoDecoder"] = {}
+        config["ModelBasic.videoDecoder"]["trace"] = True
+        config["ModelBasic.videoDecoder"]["decodingTime"] = 0.005 #5ms
+        config["ModelBasic.pictureBuffer"] = {} 
+        config["ModelBasic.pictureBuffer"]["trace"] = True
+        config["ModelBasic.syncVideo"] = {}
+        config["ModelBasic.syncVideo"]["trace"] = False
+        config["ModelBasic.outPutVideo"] = {}
+        config["ModelBasic.outPutVideo"]["trace"] = True
+        config["ModelBasic.audioDecoderBuffer"] = {}
+        config["ModelBasic.audioDecoderBuffer"]["size"] = 1 * 1024 * 1024
+        config["ModelBasic.audioDecoderBuffer"]["trace"] = True
+        config["ModelBasic.audioDecoder"] = {}
+        config["ModelBasic.audioDecoder"]["trace"] = True
+        config["ModelBasic.audioBuffer"] = {}
+        config["ModelBasic.audioBuffer"]["trace"] = True
+        config["ModelBasic.syncAudio"] = {}
+        config["ModelBasic.syncAudio"]["trace"] = False
+        config["ModelBasic.outPutAudio"] = {}
+        config["ModelBasic.outPutAudio"]["trace"] = True
+
+
+        processes = ProcessHandler(testEnviroment.maxThreads, testEnviroment.simulator)
+        simStatus = []
+
+        config["runTime"] = 60
+        config["ModelBasic.demux"]["videoPid"] = 0x100
+        config["ModelBasic.demux"]["audioPid"] = 0x101
+        config["ModelBasic.demux"]["pcrPid"] = 0x100
+        config["ModelBasic.videoDecoder"]["videoTyp"] = "h264"
+        config["ModelBasic.outPutVideo"]["framerate"] = 25.0
+        config["ModelBasic.pictureBuffer"]["size"] = int(4000*1024*1024 / (1920*1080*1.5))
+        config["ModelBasic.outPutAudio"]["framerate"] = 1/0.024
+        config["ModelBasic.audioBuffer"]["size"] = int(20*1024*1024/(0.024 * 48e3 * 2))
+        simStatus.append(processes.spawn(testDir, config))
+        simStatus.extend(processes.wait())
+
+        self.checkSimulation(simStatus)
+
+    def test_pipeline_udp_loopback(self):
+        '''
+        configure the basic pipeline, fed live over UDP on the loopback interface.
+        The simulation runs with the wall clock, so only the first 30 seconds of the file are sent.
+        '''
+                
+        testEnviroment = th.TestEnviroment()
+        files = testEnviroment.db.configGetFile("sintel")
+        testDir = testEnviroment.mainResultDir + "/test_pipeline_udp_loopback"
+        shutil.rmtree(testDir, ignore_errors = True)
         
+        config = {}
+        config["mainModel"] = "ModelBasic"
+        config["ModelBasic.read"] = {}
+        config["ModelBasic.read"]["trace"] = True
+        config["ModelBasic.read"]["element"] = "ReadUdp"
+        config["ModelBasic.read"]["address"] = "127.0.0.1"
+        config["ModelBasic.read"]["port"] = 45678
+        config["ModelBasic.read"]["receiveBuffer"] = 4 * 1024 * 1024
+        config["ModelBasic.demuxInBuffer"] = {}
+        config["ModelBasic.demuxInBuffer"]["size"] = 1
+        config["ModelBasic.demuxInBuffer"]["trace"] = False
+        config["ModelBasic.demux"] = {}
+        config["ModelBasic.demux"]["trace"] = True
+        config["ModelBasic.stc"] = {}
+        config["ModelBasic.stc"]["pcrJumpBorder"] = 100000000 # 3.7s 
+        config["ModelBasic.stc"]["trace"] = True
+        config["ModelBasic.stcOffset"] = {}
+        config["ModelBasic.stcOffset"]["offset"] = 8000000 #88.8 s * 90e3Hz
+        config["ModelBasic.stcOffset"]["trace"] = False 
+        config["ModelBasic.videoDecoderBuffer"] = {}
+        config["ModelBasic.videoDecoderBuffer"]["trace"] = True
+        config["ModelBasic.videoDecoderBuffer"]["size"] = 3 * 1024 * 1024
+        config["ModelBasic.videoDecoder"] = {}
+        config["ModelBasic.videoDecoder"]["trace"] = True
+        config["ModelBasic.videoDecoder"]["decodingTime"] = 0.005 #5ms
+        config["ModelBasic.pictureBuffer"] = {} 
+        config["ModelBasic.pictureBuffer"]["trace"] = True
+        config["ModelBasic.syncVideo"] = {}
+        config["ModelBasic.syncVideo"]["trace"] = False
+        config["ModelBasic.outPutVideo"] = {}
+        config["ModelBasic.outPutVideo"]["trace"] = True
+        config["ModelBasic.audioDecoderBuffer"] = {}
+        config["ModelBasic.audioDecoderBuffer"]["size"] = 1 * 1024 * 1024
+        config["ModelBasic.audioDecoderBuffer"]["trace"] = True
+        config["ModelBasic.audioDecoder"] = {}
+        config["ModelBasic.audioDecoder"]["trace"] = True
+        config["ModelBasic.audioBuffer"] = {}
+        config["ModelBasic.audioBuffer"]["trace"] = True
+        config["ModelBasic.syncAudio"] = {}
+        config["ModelBasic.syncAudio"]["trace"] = False
+        config["ModelBasic.outPutAudio"] = {}
+        config["ModelBasic.outPutAudio"]["trace"] = True
+
+
+        processes = ProcessHandler(testEnviroment.maxThreads, testEnviroment.simulator)
+        simStatus = []
+            
+        duration = 30
+        file = files[0]
+        config["runTime"] = duration
+        config["ModelBasic.demux"]["videoPid"] = file["videoPid"]
+        config["ModelBasic.demux"]["audioPid"] = file["audioPid"]
+        config["ModelBasic.demux"]["pcrPid"] = file["pcrPid"]
+        config["ModelBasic.videoDecoder"]["videoTyp"] = file["videoBitStreamFormat"]
+        config["ModelBasic.outPutVideo"]["framerate"] = float(file["frameRate"])
+        config["ModelBasic.pictureBuffer"]["size"] = int(4000*1024*1024 / (file["width"]*file["height"]*1.5))
+        config["ModelBasic.outPutAudio"]["framerate"] = 1/(float(file["mindPts"])/90e3)
+        config["ModelBasic.audioBuffer"]["size"] = int(20*1024*1024/(float(file["mindPts"])/90e3 * 48e3 * 2))
+        simDir = testDir + "/" + str(file["id"]) + "/v_" + str(file["videoPid"]) + "_a_" + str(file["audioPid"])
+        simStatus.append(processes.spawn(simDir, config))
+        # the reader logs, when the socket is open
+        self.assertTrue(th.waitForLog(simDir + "/stdout.log", "receiving on \"127.0.0.1:45678\"", 60),
+                        "simulator did not open the socket")
+        th.sendUdp(file["stream"], "127.0.0.1", 45678, file["overallBitrate"], duration)
+        simStatus.extend(processes.wait())
+
+        self.checkSimulation(simStatus)
+
+
+    def test_pipeline_loop(self):
+        '''
+        play a 10 second clip of sintel in a loop, for longer than the clip. The looped stream has to be
+        continuous: no continuity counter errors in the demux, and no picture timestamps jumping backwards.
+        '''
+
+        testEnviroment = th.TestEnviroment()
+        file = testEnviroment.db.configGetFile("sintel")[0]
+        testDir = testEnviroment.mainResultDir + "/test_pipeline_loop"
+        shutil.rmtree(testDir, ignore_errors = True)
+        os.makedirs(testDir)
+
+        clip = testDir + "/clip.ts"
+        th.cutStream(file["stream"], clip, file["overallBitrate"], 10)
+
+        config = self.fileConfig(file)
+        config["runTime"] = 35
+        config["ModelBasic.read"]["filename"] = clip
+        config["ModelBasic.read"]["loop"] = True
+
+        processes = ProcessHandler(testEnviroment.maxThreads, testEnviroment.simulator)
+        simStatus = []
+        simStatus.append(processes.spawn(testDir, config))
+        simStatus.extend(processes.wait())
+
+        self.checkSimulation(simStatus)
+        with open(testDir + "/stdout.log") as f:
+            log = f.read()
+        self.assertNotIn("continuity counter fail", log)
+        self.assertNotIn("before the last request", log)
+
+
+    def test_pipeline_remux(self):
+        '''
+        remux sintel and big buck bunny into one MPTS with the RemuxMpts, and play the second program. Its
+        video and audio are the first two streams of the second pid block, 0x111 and 0x112.
+        '''
+
+        testEnviroment = th.TestEnviroment()
+        first = testEnviroment.db.configGetFile("sintel")[0]
+        second = testEnviroment.db.configGetFile("bbb")[0]
+        testDir = testEnviroment.mainResultDir + "/test_pipeline_remux"
+        shutil.rmtree(testDir, ignore_errors = True)
+
+        config = self.fileConfig(second)
+        config["runTime"] = 60
+        config["ModelBasic.read"] = {}
+        config["ModelBasic.read"]["trace"] = True
+        config["ModelBasic.read"]["element"] = "RemuxMpts"
+        config["ModelBasic.read"]["filenames"] = [first["stream"], second["stream"]]
+        config["ModelBasic.demux"]["videoPid"] = 0x111
+        config["ModelBasic.demux"]["audioPid"] = 0x112
+        if second["pcrPid"] == second["videoPid"]:
+            config["ModelBasic.demux"]["pcrPid"] = 0x111
+        elif second["pcrPid"] == second["audioPid"]:
+            config["ModelBasic.demux"]["pcrPid"] = 0x112
+        else:
+            config["ModelBasic.demux"]["pcrPid"] = 0x11f
+
+        processes = ProcessHandler(testEnviroment.maxThreads, testEnviroment.simulator)
+        simStatus = []
+        simStatus.append(processes.spawn(testDir, config))
+        simStatus.extend(processes.wait())
+
+        self.checkSimulation(simStatus)
+        with open(testDir + "/stdout.log") as f:
+            log = f.read()
+        self.assertNotIn("could not use", log)
+        self.assertNotIn("continuity counter fail", log)
+
+
+    def test_pipeline_memory_model(self):
+        '''
+        trace the memory model of sintel with a small picture buffer. The decoder is ahead of the output, so
+        the picture buffer runs full, and the modeled peak holds at least size pictures of width * height *
+        1.5 bytes (yuv420), while the picture buffer alone never models more than that.
+        '''
+
+        testEnviroment = th.TestEnviroment()
+        file = testEnviroment.db.configGetFile("sintel")[0]
+        testDir = testEnviroment.mainResultDir + "/test_pipeline_memory_model"
+        shutil.rmtree(testDir, ignore_errors = True)
+
+        config = self.fileConfig(file)
+        config["runTime"] = 30
+        config["traceMemoryModel"] = True
+        config["ModelBasic.pictureBuffer"]["size"] = 8
+        config["ModelBasic.pictureBuffer"]["width"] = file["width"]
+        config["ModelBasic.pictureBuffer"]["height"] = file["height"]
+
+        processes = ProcessHandler(testEnviroment.maxThreads, testEnviroment.simulator)
+        simStatus = []
+        simStatus.append(processes.spawn(testDir, config))
+        simStatus.extend(processes.wait())
+
+        self.checkSimulation(simStatus)
+        pictureBytes = config["ModelBasic.pictureBuffer"]["size"] * file["width"] * file["height"] * 1.5
+        peak = max(self.traceValues(testDir + "/memoryModel.peakBytes.csv"))
+        pictures = max(self.traceValues(testDir + "/ModelBasic.pictureBuffer.modeledBytes.csv"))
+        self.assertGreaterEqual(peak, pictureBytes)
+        self.assertEqual(pictures, pictureBytes)
+
+    def test_pipeline_memory_pool(self):
+        '''
+        play sintel with the decoder buffers in a shared memory pool, once with the "static" and once with the
+        "firstCome" policy, and compare the summaries of the pool. The small picture buffer stalls the video
+        decoder, so its buffer runs full: with "static" it blocks at its share, with "firstCome" it bursts into
+        the rest of the pool. The larger buffer must not cause more underruns.
+        '''
+
+        testEnviroment = th.TestEnviroment()
+        file = testEnviroment.db.configGetFile("sintel")[0]
+        testDir = testEnviroment.mainResultDir + "/test_pipeline_memory_pool"
+        shutil.rmtree(testDir, ignore_errors = True)
+
+        share = 1024 * 1024
+        poolSize = 4 * 1024 * 1024
+        processes = ProcessHandler(testEnviroment.maxThreads, testEnviroment.simulator)
+        simStatus = []
+        for policy in ["static", "firstCome"]:
+            config = self.fileConfig(file)
+            config["runTime"] = 30
+            config["ModelBasic.videoDecoderBuffer"]["size"] = share
+            config["ModelBasic.audioDecoderBuffer"]["size"] = share
+            config["ModelBasic.pictureBuffer"]["size"] = 8
+            config["ModelBasic.memoryPool"] = {}
+            config["ModelBasic.memoryPool"]["size"] = poolSize
+            config["ModelBasic.memoryPool"]["policy"] = policy
+            config["ModelBasic.memoryPool"]["trace"] = True
+            simStatus.append(processes.spawn(testDir + "/" + policy, config))
+        simStatus.extend(processes.wait())
+        self.checkSimulation(simStatus)
+
+        static = self.poolSummary(testDir + "/static/stdout.log", "static")
+        firstCome = self.poolSummary(testDir + "/firstCome/stdout.log", "firstCome")
+
+        video = "ModelBasic.videoDecoderBuffer"
+        self.assertLessEqual(static[video]["peak"], share)
+        self.assertGreater(static[video]["blocked"], 0)
+        self.assertGreater(firstCome[video]["peak"], share)
+        self.assertLessEqual(firstCome["pool"]["peak"], poolSize)
+        self.assertLessEqual(firstCome["pool"]["underruns"], static["pool"]["underruns"])
+
+    def poolSummary(self, logFile, policy):
+        '''
+        the summary of the memory pool in the log: share (size for the whole pool), peak, underruns and blocked
+        per buffer, and of the whole pool as "pool".
+        '''
+        with open(logFile) as f:
+            log = f.read()
+        summary = {}
+        for line in re.findall(r"memoryPool \(" + policy + r"\) (\S+): share: (\d+) peak: (\d+) underruns: (\d+) blocked: (\d+)", log):
+            summary[line[0]] = {"share":int(line[1]), "peak":int(line[2]), "underruns":int(line[3]), "blocked":int(line[4])}
+        line = re.search(r"memoryPool \(" + policy + r"\): size: (\d+) peak: (\d+) underruns: (\d+) blocked: (\d+)", log)
+        self.assertIsNotNone(line, "no summary of the memory pool in " + logFile)
+        summary["pool"] = {"share":int(line.group(1)), "peak":int(line.group(2)), "underruns":int(line.group(3)), "blocked":int(line.group(4))}
+        self.assertIn("ModelBasic.videoDecoderBuffer", summary)
+        return summary
+
+    def traceValues(self, pathCsv):
+        '''
+        the traced values of a csv trace, without the times.
+        '''
+        with open(pathCsv) as f:
+            f.readline()
+            return [float(line.split(",")[1]) for line in f if line.strip()]
+
+
 if __name__ == "__main__":
     #import sys;sys.argv = ['', 'Test.testName']
     unittest.main()
\ No newline at end of file